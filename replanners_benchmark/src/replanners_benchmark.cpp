@@ -5,6 +5,7 @@
 #include<replanners_lib/replanner_managers/replanner_manager_MPRRT.h>
 #include<replanners_lib/replanner_managers/replanner_manager_DRRTStar.h>
 #include<replanners_lib/replanner_managers/replanner_manager_anytimeDRRT.h>
+#include<replanners_lib/replanner_managers/replanner_manager_portfolio.h>
 
 int main(int argc, char **argv)
 {
@@ -269,6 +270,10 @@ int main(int argc, char **argv)
         {
           replanner_manager.reset(new pathplan::ReplannerManagerAnytimeDRRT(current_path,solver,nh));
         }
+        else if(replanner_type == "portfolio")
+        {
+          replanner_manager.reset(new pathplan::ReplannerManagerPortfolio(current_path,solver,nh));
+        }
         else if(replanner_type == "MARS")
         {
           int n_other_paths;
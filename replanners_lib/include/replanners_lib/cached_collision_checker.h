@@ -0,0 +1,109 @@
+#ifndef CACHED_COLLISION_CHECKER_H__
+#define CACHED_COLLISION_CHECKER_H__
+
+#include <map>
+#include <graph_core/collision_checker.h>
+#include <graph_core/graph/connection.h>
+#include <replanners_lib/worker_pool.h>
+
+namespace pathplan
+{
+class CachedCollisionChecker;
+typedef std::shared_ptr<CachedCollisionChecker> CachedCollisionCheckerPtr;
+
+/* Wrapper of a collision checker which answers checkPath/checkConnection from the results of segments checked in advance.
+ * prefetch() checks a set of segments concurrently on a worker pool, each task with its own checker (clones of the wrapped
+ * one, with the same scene). The results are found only for the very same configurations, so the segments must be built
+ * from the configurations the algorithm will check (node configurations, or the one it will create). Segments not prefetched are checked by the wrapped checker, so the results are the same as with the
+ * wrapped checker alone: algorithms which check their candidate connections one at a time (e.g. the rewiring of the
+ * graph_core trees) keep their serial logic and order, but find the checks already done. */
+class CachedCollisionChecker: public CollisionChecker
+{
+protected:
+  CollisionCheckerPtr checker_;
+  std::map<std::vector<double>,bool> results_;
+
+  static std::vector<double> key(const Eigen::VectorXd& configuration1, const Eigen::VectorXd& configuration2)
+  {
+    std::vector<double> k(configuration1.size()+configuration2.size());
+    Eigen::VectorXd::Map(k.data(),configuration1.size()) = configuration1;
+    Eigen::VectorXd::Map(k.data()+configuration1.size(),configuration2.size()) = configuration2;
+    return k;
+  }
+
+  bool lookUp(const Eigen::VectorXd& configuration1, const Eigen::VectorXd& configuration2, bool& result) const
+  {
+    std::map<std::vector<double>,bool>::const_iterator it = results_.find(key(configuration1,configuration2));
+    if(it == results_.end())
+      return false;
+
+    result = it->second;
+    return true;
+  }
+
+public:
+  CachedCollisionChecker(const CollisionCheckerPtr& checker): checker_(checker) {}
+
+  CollisionCheckerPtr getWrappedChecker() const
+  {
+    return checker_;
+  }
+
+  /* Check the segments concurrently on the pool, task i uses checkers[i] */
+  void prefetch(const std::vector<std::pair<Eigen::VectorXd,Eigen::VectorXd>>& segments, const std::vector<CollisionCheckerPtr>& checkers,
+                const WorkerPoolPtr& pool)
+  {
+    if(segments.empty() || checkers.empty())
+      return;
+
+    std::vector<char> results(segments.size()); //written concurrently, one element per segment
+
+    unsigned int n_tasks = std::min(checkers.size(),segments.size());
+    pool->parallelFor(n_tasks,[&](const unsigned int& i)->void{
+      for(unsigned int j=i;j<segments.size();j+=n_tasks)
+        results[j] = checkers[i]->checkPath(segments[j].first,segments[j].second);
+    });
+
+    for(unsigned int j=0;j<segments.size();j++)
+    {
+      results_[key(segments[j].first ,segments[j].second)] = results[j];
+      results_[key(segments[j].second,segments[j].first )] = results[j];
+    }
+  }
+
+  void clear()
+  {
+    results_.clear();
+  }
+
+  bool check(const Eigen::VectorXd& configuration) override
+  {
+    return checker_->check(configuration);
+  }
+
+  bool checkPath(const Eigen::VectorXd& configuration1, const Eigen::VectorXd& configuration2) override
+  {
+    bool result;
+    if(lookUp(configuration1,configuration2,result))
+      return result;
+
+    return checker_->checkPath(configuration1,configuration2);
+  }
+
+  bool checkConnection(const ConnectionPtr& conn) override
+  {
+    bool result;
+    if(lookUp(conn->getParent()->getConfiguration(),conn->getChild()->getConfiguration(),result))
+      return result;
+
+    return checker_->checkConnection(conn);
+  }
+
+  CollisionCheckerPtr clone() override
+  {
+    return std::make_shared<CachedCollisionChecker>(checker_->clone());
+  }
+};
+}
+
+#endif // CACHED_COLLISION_CHECKER_H__
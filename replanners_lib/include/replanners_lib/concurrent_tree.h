@@ -0,0 +1,67 @@
+#ifndef CONCURRENT_TREE_H__
+#define CONCURRENT_TREE_H__
+
+#include <cmath>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <eigen3/Eigen/Core>
+
+namespace pathplan
+{
+class ConcurrentTree;
+typedef std::shared_ptr<ConcurrentTree> ConcurrentTreePtr;
+
+/* Tree grown by several threads at the same time (no rewiring, nodes are never removed).
+ * Nodes are stored in arrays preallocated at construction: a thread reserves a slot with an atomic counter, writes
+ * configuration, parent and cost-to-come, then publishes the slot. Readers (nearest, getters) see only published slots,
+ * so insertion and search never lock. The nearest neighbour search is a linear scan of the contiguous configurations. */
+class ConcurrentTree
+{
+protected:
+  unsigned int dof_;
+  unsigned int capacity_;
+  std::vector<double> configurations_;  //slot i starts at i*dof_
+  std::vector<int> parents_;
+  std::vector<double> costs_;
+  std::unique_ptr<std::atomic<bool>[]> published_;
+  std::atomic<unsigned int> reserved_;
+
+public:
+  ConcurrentTree(const Eigen::VectorXd& root, const unsigned int& capacity);
+
+  /* Add a node and return its index, -1 if the tree is full */
+  int add(const Eigen::VectorXd& configuration, const int& parent, const double& cost);
+
+  /* Index of the published node closest to configuration */
+  int nearest(const Eigen::VectorXd& configuration, double& distance) const;
+
+  /* Indices of the nodes from the root to idx */
+  std::vector<int> branch(const int& idx) const;
+
+  Eigen::VectorXd getConfiguration(const int& idx) const
+  {
+    return Eigen::Map<const Eigen::VectorXd>(configurations_.data()+idx*dof_,dof_);
+  }
+
+  double getCost(const int& idx) const
+  {
+    return costs_[idx];
+  }
+
+  unsigned int size() const
+  {
+    return std::min(reserved_.load(std::memory_order_acquire),capacity_);
+  }
+
+  unsigned int getCapacity() const
+  {
+    return capacity_;
+  }
+};
+}
+
+#endif // CONCURRENT_TREE_H__
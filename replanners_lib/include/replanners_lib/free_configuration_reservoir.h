@@ -0,0 +1,136 @@
+#ifndef FREE_CONFIGURATION_RESERVOIR_H__
+#define FREE_CONFIGURATION_RESERVOIR_H__
+
+#include <deque>
+#include <mutex>
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <eigen3/Eigen/Core>
+#include <eigen3/Eigen/Geometry>
+#include <graph_core/sampler.h>
+#include <graph_core/collision_checker.h>
+
+#define FREE_RESERVOIR_MAX_ADD 50
+#define FREE_RESERVOIR_TRIES 5
+#define FREE_RESERVOIR_MAX_WORLD_CHANGES 100 //world changes remembered to skip the checks of configurations far from them
+
+namespace pathplan
+{
+class FreeConfigurationReservoir;
+typedef std::shared_ptr<FreeConfigurationReservoir> FreeConfigurationReservoirPtr;
+
+class FreeReservoirSampler;
+typedef std::shared_ptr<FreeReservoirSampler> FreeReservoirSamplerPtr;
+
+/* Bounded set of configurations found collision free by the replanners, each one tagged with the world version it was
+ * validated against. When full, a new configuration replaces a random one, so old and recent configurations coexist.
+ * A configuration drawn in the same world version it was validated in is returned as it is. Otherwise, if a footprint
+ * is set (workspace box of the robot in a configuration) and none of the objects added or moved by the world changes
+ * since its version is within its footprint, its version is updated without checking it. Otherwise it is checked
+ * again: if free its version is updated, if not it is removed (the last configuration takes its slot, so the first size_
+ * slots are always filled and the draws never hit an empty slot). Thread safe, the check is done outside the lock. */
+class FreeConfigurationReservoir
+{
+protected:
+  struct WorldChange
+  {
+    unsigned long version;
+    std::vector<Eigen::AlignedBox3d> boxes; //objects added or moved
+  };
+
+  unsigned int dof_;
+  unsigned int capacity_;
+  Eigen::MatrixXd configurations_;
+  std::vector<unsigned long> versions_;
+  std::vector<Eigen::AlignedBox3d> footprints_;
+  std::function<Eigen::AlignedBox3d(const Eigen::VectorXd&)> footprint_;
+  std::deque<WorldChange> world_changes_;
+  unsigned int size_;
+  std::mt19937 gen_;
+  std::mutex mtx_;
+
+  /* True if an object changed between world versions from (excluded) and to is within footprint, or if the changes
+   * or the footprint (empty box) are not known. Called with mtx_ held */
+  bool changedNear(const Eigen::AlignedBox3d& footprint, const unsigned long& from, const unsigned long& to) const;
+
+public:
+  FreeConfigurationReservoir(const unsigned int& dof, const unsigned int& capacity);
+
+  void add(const Eigen::VectorXd& configuration, const unsigned long& world_version);
+
+  /* Must be thread safe, it is called by the threads adding configurations */
+  void setFootprint(const std::function<Eigen::AlignedBox3d(const Eigen::VectorXd&)>& footprint)
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    footprint_ = footprint;
+  }
+
+  /* Boxes of the objects added or moved by the change to world_version (removed objects can not make a configuration
+   * collide), an infinite box if the change can not be located */
+  void addWorldChange(const unsigned long& world_version, const std::vector<Eigen::AlignedBox3d>& boxes);
+
+  /* Draw a configuration satisfying accept (e.g. inside an informed set), at most FREE_RESERVOIR_TRIES attempts.
+   * Returns false if no valid configuration has been found */
+  bool draw(const std::function<bool(const Eigen::VectorXd&)>& accept,
+            const CollisionCheckerPtr& checker,
+            const unsigned long& world_version,
+            Eigen::VectorXd& configuration);
+
+  unsigned int size()
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return size_;
+  }
+
+  unsigned int getCapacity() const
+  {
+    return capacity_;
+  }
+};
+
+/* Sampler which draws from a FreeConfigurationReservoir with probability bias, restricted to the informed set of the
+ * wrapped sampler, and falls back to the wrapped sampler otherwise */
+class FreeReservoirSampler: public InformedSampler
+{
+protected:
+  InformedSamplerPtr sampler_;
+  FreeConfigurationReservoirPtr reservoir_;
+  CollisionCheckerPtr checker_;
+  unsigned long world_version_;
+  double bias_;
+
+  Eigen::VectorXd focus1_;
+  Eigen::VectorXd focus2_;
+  Eigen::VectorXd lb_;
+  Eigen::VectorXd ub_;
+  double cost_bound_;
+
+  std::minstd_rand gen_;
+  std::uniform_real_distribution<double> ud_;
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  FreeReservoirSampler(const Eigen::VectorXd& start_configuration,
+                       const Eigen::VectorXd& stop_configuration,
+                       const Eigen::VectorXd& lower_bound,
+                       const Eigen::VectorXd& upper_bound,
+                       const InformedSamplerPtr& sampler,
+                       const FreeConfigurationReservoirPtr& reservoir,
+                       const CollisionCheckerPtr& checker,
+                       const unsigned long& world_version,
+                       const double& bias,
+                       const double& cost = std::numeric_limits<double>::infinity());
+
+  virtual Eigen::VectorXd sample() override;
+  virtual void setCost(const double& cost) override;
+};
+
+}
+
+#endif // FREE_CONFIGURATION_RESERVOIR_H__
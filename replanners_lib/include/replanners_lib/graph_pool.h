@@ -0,0 +1,200 @@
+#ifndef GRAPH_POOL_H__
+#define GRAPH_POOL_H__
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <graph_core/graph/node.h>
+#include <graph_core/graph/connection.h>
+
+#define GRAPH_POOL_MAX_FREE_BLOCKS 16384
+
+namespace pathplan
+{
+/* Thread-local pool for the Nodes and Connections created by the replanners.
+ * makeNode/makeConnection allocate the object together with its shared_ptr control block (std::allocate_shared) from
+ * a free list of the calling thread, so the replanning threads do not contend in malloc. When the last reference is
+ * dropped (paths and trees released), the block goes back to the free list of the thread that releases it.
+ * Blocks are independent heap allocations, so a block can be released by a thread different from the one that allocated it. */
+struct GraphPoolStats
+{
+  unsigned long allocations; //objects created through the pool
+  unsigned long reused;      //allocations served by a free list
+};
+
+namespace graph_pool
+{
+/* Counters of the calling thread, so that the allocations of a thread are not mixed with the ones of the threads
+ * running concurrently (improver, portfolio members..) */
+inline unsigned long& allocationsCounter()
+{
+  static thread_local unsigned long counter = 0;
+  return counter;
+}
+
+inline unsigned long& reusedCounter()
+{
+  static thread_local unsigned long counter = 0;
+  return counter;
+}
+
+template<std::size_t SIZE>
+class FreeList
+{
+protected:
+  std::vector<void*> blocks_;
+
+public:
+  static thread_local bool alive_; //false after the destruction of the free list of the thread
+
+  FreeList()
+  {
+    alive_ = true;
+  }
+
+  ~FreeList()
+  {
+    alive_ = false;
+    for(void* block:blocks_)
+      ::operator delete(block);
+  }
+
+  void* get()
+  {
+    allocationsCounter()++;
+    if(blocks_.empty())
+      return ::operator new(SIZE);
+
+    reusedCounter()++;
+    void* block = blocks_.back();
+    blocks_.pop_back();
+    return block;
+  }
+
+  void put(void* block)
+  {
+    if(blocks_.size()<GRAPH_POOL_MAX_FREE_BLOCKS)
+      blocks_.push_back(block);
+    else
+      ::operator delete(block);
+  }
+};
+
+template<std::size_t SIZE>
+thread_local bool FreeList<SIZE>::alive_ = false;
+
+template<std::size_t SIZE>
+FreeList<SIZE>& freeList()
+{
+  static thread_local FreeList<SIZE> list;
+  return list;
+}
+
+template<typename T>
+class PoolAllocator
+{
+public:
+  typedef T value_type;
+
+  PoolAllocator() noexcept {}
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n)
+  {
+    static_assert(alignof(T)<=alignof(std::max_align_t),"over-aligned types are not supported by the graph pool");
+
+    if(n != 1)
+      return static_cast<T*>(::operator new(n*sizeof(T)));
+    return static_cast<T*>(freeList<sizeof(T)>().get());
+  }
+
+  void deallocate(T* p, std::size_t n)
+  {
+    if(n != 1 || (not FreeList<sizeof(T)>::alive_)) //objects released during the thread exit
+      ::operator delete(p);
+    else
+      freeList<sizeof(T)>().put(p);
+  }
+};
+
+template<typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+  return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+  return false;
+}
+
+/* Allocations made by tasks running on the threads of a worker pool on behalf of the thread which created the object.
+ * Each task is wrapped by run, which records the allocations of the worker thread; the owner thread adds them to its
+ * own counters at destruction, so that its graphPoolStats include the work of the pool. Tasks run by the owner thread
+ * itself are already counted */
+class TaskCounters
+{
+protected:
+  std::thread::id owner_;
+  std::atomic<unsigned long> allocations_;
+  std::atomic<unsigned long> reused_;
+
+public:
+  TaskCounters(): owner_(std::this_thread::get_id()), allocations_(0), reused_(0) {}
+
+  ~TaskCounters()
+  {
+    allocationsCounter() += allocations_;
+    reusedCounter()      += reused_;
+  }
+
+  TaskCounters(const TaskCounters&) = delete;
+  TaskCounters& operator=(const TaskCounters&) = delete;
+
+  template<typename F>
+  void run(F&& task)
+  {
+    if(std::this_thread::get_id() == owner_)
+    {
+      task();
+      return;
+    }
+
+    unsigned long allocations = allocationsCounter();
+    unsigned long reused      = reusedCounter();
+
+    task();
+
+    allocations_ += allocationsCounter()-allocations;
+    reused_      += reusedCounter()     -reused;
+  }
+};
+}
+
+template<typename... Args>
+NodePtr makeNode(Args&&... args)
+{
+  return std::allocate_shared<Node>(graph_pool::PoolAllocator<Node>(),std::forward<Args>(args)...);
+}
+
+template<typename... Args>
+ConnectionPtr makeConnection(Args&&... args)
+{
+  return std::allocate_shared<Connection>(graph_pool::PoolAllocator<Connection>(),std::forward<Args>(args)...);
+}
+
+/* Counters of the calling thread. The objects created by other threads are included only if their tasks are recorded
+ * with a graph_pool::TaskCounters of the calling thread (MPRRT workers) */
+inline GraphPoolStats graphPoolStats()
+{
+  GraphPoolStats stats;
+  stats.allocations = graph_pool::allocationsCounter();
+  stats.reused      = graph_pool::reusedCounter     ();
+  return stats;
+}
+}
+
+#endif // GRAPH_POOL_H__
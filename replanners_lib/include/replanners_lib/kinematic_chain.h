@@ -0,0 +1,81 @@
+#ifndef KINEMATIC_CHAIN_H__
+#define KINEMATIC_CHAIN_H__
+
+#include <ros/ros.h>
+#include <algorithm>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <moveit/robot_model/prismatic_joint_model.h>
+
+namespace pathplan
+{
+class KinematicChain;
+typedef std::shared_ptr<KinematicChain> KinematicChainPtr;
+
+/* Forward kinematics of a single link of a group, precomputed from the robot model.
+ * The chain from the first actuated joint of the group to the tip link is stored as a list of fixed transforms and joint axes,
+ * joints not belonging to the group (or mimic joints) are folded into the fixed transforms using their values in the current state of the scene.
+ * It does not allocate and does not touch any RobotState, so it can be used by threads which only need the position of the tip link. */
+class KinematicChain
+{
+protected:
+  struct Joint
+  {
+    Eigen::Isometry3d origin;  //fixed transform from the previous joint frame to this joint
+    Eigen::Vector3d axis;
+    bool revolute;
+    int index;                 //index of the joint variable in the group configuration
+  };
+
+  std::string tip_link_;
+  unsigned int dof_;
+  Eigen::Isometry3d base_;     //global transform of the parent link of the first joint
+  Eigen::Isometry3d tip_;      //fixed transform from the last joint frame to the tip link
+  std::vector<Joint> joints_;
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  KinematicChain(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                 const std::string& group_name,
+                 const std::string& tip_link);
+
+  std::string getTipLink() const
+  {
+    return tip_link_;
+  }
+
+  unsigned int getNumberOfJoints() const
+  {
+    return joints_.size();
+  }
+
+  Eigen::Isometry3d transform(const Eigen::VectorXd& conf) const;
+  Eigen::Vector3d position(const Eigen::VectorXd& conf) const;
+};
+
+class GroupFootprint;
+typedef std::shared_ptr<GroupFootprint> GroupFootprintPtr;
+
+/* Workspace box containing the links of the robot with collision geometry in a configuration of a group.
+ * Each link is bounded by a sphere around its origin (from the extents of its shapes); the links moved by the group are
+ * placed with a KinematicChain, the other ones are fixed in their pose in the current state of the scene.
+ * As KinematicChain, it does not allocate */
+class GroupFootprint
+{
+protected:
+  std::vector<KinematicChainPtr> chains_;
+  std::vector<double> radii_;      //of the links of chains_
+  Eigen::AlignedBox3d fixed_box_;  //links not moved by the group
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  GroupFootprint(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                 const std::string& group_name);
+
+  Eigen::AlignedBox3d box(const Eigen::VectorXd& conf) const;
+};
+}
+
+#endif // KINEMATIC_CHAIN_H__
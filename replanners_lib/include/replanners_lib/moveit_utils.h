@@ -23,6 +23,10 @@ protected:
   planning_scene::PlanningScenePtr planning_scene_;
   std::string group_name_;
 
+  /* Scratch state of the calling thread (thread_local, no locks), copied from the current state of the planning scene
+   * the first time a thread uses it with this robot model */
+  moveit::core::RobotState& scratchState() const;
+
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
@@ -37,6 +41,13 @@ public:
   std::vector<moveit::core::RobotState> fromWaypoints2State(const std::vector<Eigen::VectorXd> waypoints) const;
   moveit::core::RobotState fromWaypoints2State(const Eigen::VectorXd &waypoint) const;
 
+  /* Fill wp_state_vector with the states of the waypoints. The elements already present are reused, only the missing ones are copied from the current state */
+  void fromWaypoints2State(const std::vector<Eigen::VectorXd>& waypoints, std::vector<moveit::core::RobotState>& wp_state_vector) const;
+
+  /* Global transform of link, computed on the thread scratch state along the chain from the root to link only */
+  Eigen::Isometry3d forwardKinematics(const Eigen::VectorXd &waypoint, const std::string& link) const;
+  Eigen::Isometry3d forwardKinematics(const Eigen::VectorXd &waypoint, const std::string& link, moveit::core::RobotState& state) const;
+
 };
 }
 
@@ -0,0 +1,144 @@
+#ifndef PATH_INDEX_H__
+#define PATH_INDEX_H__
+
+#include <algorithm>
+#include <graph_core/graph/path.h>
+
+#define PATH_INDEX_BLOCK 16 //connections processed at once by nearestConnection, on fixed-size arrays
+
+namespace pathplan
+{
+class PathIndex;
+typedef std::shared_ptr<PathIndex> PathIndexPtr;
+typedef std::shared_ptr<const PathIndex> PathIndexConstPtr;
+
+/* Query structure for a path with fixed geometry: waypoints, prefix-sum of the connection lengths and suffix-sum of the costs.
+ * Locating a configuration on the path starts from a hint (the connection found by the previous query of the caller),
+ * abscissa <-> point conversions are binary searches. Abscissas are normalized in [0,1] as in Path.
+ * Costs can be updated connection by connection, the suffix costs are rebuilt at the first query that needs them.
+ * Waypoints are stored as a contiguous column-major matrix (one row per waypoint, one column per joint), so that the
+ * kernels scanning all the connections (nearestConnection, full search of findConnection) run over contiguous arrays
+ * of PATH_INDEX_BLOCK connections at a time and are vectorized by Eigen (AVX2 with REPLANNERS_LIB_AVX2).
+ * The kernels are instantiated for 3, 6, 12 and 18 dof with fixed-size Eigen types (no heap temporaries, loops over the
+ * joints unrolled) and for a dynamic number of dof; the instantiation is selected at construction from the path dof.
+ * The queries with an output argument write into the caller storage, so they do not allocate once it has the path dof. */
+class PathIndex
+{
+protected:
+  Eigen::MatrixXd waypoints_;          //n_connections+1 x dof
+  Eigen::MatrixXd segments_;           //n_connections x dof, child-parent
+  Eigen::ArrayXd segment_sq_length_;
+  Eigen::ArrayXd segment_length_;
+  std::vector<double> prefix_length_;  //length from the start to waypoint i
+  std::vector<double> conn_cost_;
+  mutable std::vector<double> suffix_cost_;  //cost from waypoint i to the goal
+  mutable bool costs_changed_;
+
+  bool (PathIndex::*is_on_connection_)(const Eigen::VectorXd&, const unsigned int&) const;
+  int  (PathIndex::*find_connection_)(const Eigen::VectorXd&, const int&) const;
+  int  (PathIndex::*nearest_connection_)(const Eigen::VectorXd&, Eigen::VectorXd&, double&, const int&, const int&) const;
+
+  template<int DOF>
+  void selectKernels();
+  template<int DOF>
+  bool isOnConnectionKernel(const Eigen::VectorXd& conf, const unsigned int& idx) const;
+  template<int DOF>
+  int findConnectionKernel(const Eigen::VectorXd& conf, const int& hint) const;
+  template<int DOF>
+  int nearestConnectionKernel(const Eigen::VectorXd& conf, Eigen::VectorXd& projection, double& distance,
+                              const int& first, const int& last) const;
+
+  bool isOnConnection(const Eigen::VectorXd& conf, const unsigned int& idx) const
+  {
+    return (this->*is_on_connection_)(conf,idx);
+  }
+  void updateSuffixCost() const;
+
+  /* Position in [0,1] of the projection of conf on connection idx */
+  double projectionRatio(const Eigen::VectorXd& conf, const unsigned int& idx) const
+  {
+    if(segment_sq_length_(idx)<=0.0)
+      return 0.0;
+
+    double t = (conf.transpose()-waypoints_.row(idx)).dot(segments_.row(idx))/segment_sq_length_(idx);
+    return std::max(0.0,std::min(1.0,t));
+  }
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  PathIndex(const PathPtr& path);
+
+  unsigned int getConnectionsSize() const
+  {
+    return conn_cost_.size();
+  }
+
+  unsigned int getDof() const
+  {
+    return waypoints_.cols();
+  }
+
+  Eigen::VectorXd getWaypoint(const unsigned int& idx) const
+  {
+    return waypoints_.row(idx).transpose();
+  }
+
+  double length() const
+  {
+    return prefix_length_.back();
+  }
+
+  /* Index of the connection which contains conf, -1 if conf is not on the path. The search starts from hint */
+  int findConnection(const Eigen::VectorXd& conf, const int& hint = -1) const
+  {
+    return (this->*find_connection_)(conf,hint);
+  }
+
+  /* As findConnection, but if conf is not on the path returns the connection closest to conf */
+  int locate(const Eigen::VectorXd& conf, const int& hint = -1) const;
+
+  /* Connection closest to conf among connections [first,last] (all by default), projection is the closest point on it */
+  int nearestConnection(const Eigen::VectorXd& conf, Eigen::VectorXd& projection, double& distance,
+                        const int& first = 0, const int& last = -1) const
+  {
+    return (this->*nearest_connection_)(conf,projection,distance,first,last);
+  }
+
+  /* Projection of point on the connections from hint to the goal (the whole path if hint<0), idx is the connection of the projection */
+  void projectOnPath(const Eigen::VectorXd& point, Eigen::VectorXd& projection, int& idx, const int& hint = -1) const
+  {
+    double distance;
+    idx = nearestConnection(point,projection,distance,std::max(0,hint));
+  }
+  Eigen::VectorXd projectOnPath(const Eigen::VectorXd& point, int& idx, const int& hint = -1) const
+  {
+    Eigen::VectorXd projection;
+    projectOnPath(point,projection,idx,hint);
+    return projection;
+  }
+
+  double curvilinearAbscissaOfPoint(const Eigen::VectorXd& conf, int& idx, const int& hint = -1) const;
+  void pointOnCurvilinearAbscissa(const double& abscissa, Eigen::VectorXd& point) const;
+  Eigen::VectorXd pointOnCurvilinearAbscissa(const double& abscissa) const
+  {
+    Eigen::VectorXd point;
+    pointOnCurvilinearAbscissa(abscissa,point);
+    return point;
+  }
+
+  double getConnectionCost(const unsigned int& idx) const
+  {
+    return conn_cost_.at(idx);
+  }
+  void setConnectionCost(const unsigned int& idx, const double& cost);
+  double getCostFromConf(const Eigen::VectorXd& conf, int& idx, const int& hint = -1) const;
+  double getCostFromConf(const Eigen::VectorXd& conf, const int& hint = -1) const
+  {
+    int idx;
+    return getCostFromConf(conf,idx,hint);
+  }
+};
+}
+
+#endif // PATH_INDEX_H__
@@ -0,0 +1,51 @@
+#ifndef PATH_SNAPSHOT_H__
+#define PATH_SNAPSHOT_H__
+
+#include <mutex>
+#include <replanners_lib/path_index.h>
+
+namespace pathplan
+{
+class PathSnapshot;
+typedef std::shared_ptr<const PathSnapshot> PathSnapshotPtr;
+
+/* Immutable copy of a path, created once per path version and shared among threads by pointer.
+ * The path must be used only for queries which do not modify it (projectOnPath, curvilinearAbscissaOfPoint,
+ * pointOnCurvilinearAbscissa, findConnection, getSubpathFromConf with get_copy = true, display..).
+ * Costs and checker are frozen at creation: consumers which need updated costs read them from the shared path.
+ * The PathIndex of the snapshot is built at the first request. */
+class PathSnapshot
+{
+protected:
+  PathPtr path_;
+  unsigned long version_;
+
+  mutable std::once_flag index_flag_;
+  mutable PathIndexConstPtr index_;
+
+public:
+  PathSnapshot(const PathPtr& path, const unsigned long& version)
+  {
+    path_ = path->clone();
+    version_ = version;
+  }
+
+  const PathPtr& getPath() const
+  {
+    return path_;
+  }
+
+  unsigned long getVersion() const
+  {
+    return version_;
+  }
+
+  const PathIndexConstPtr& getIndex() const
+  {
+    std::call_once(index_flag_,[this](){index_ = std::make_shared<const PathIndex>(path_);});
+    return index_;
+  }
+};
+}
+
+#endif // PATH_SNAPSHOT_H__
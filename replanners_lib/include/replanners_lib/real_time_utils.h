@@ -0,0 +1,50 @@
+#ifndef REAL_TIME_UTILS_H__
+#define REAL_TIME_UTILS_H__
+
+#include <time.h>
+#include <cerrno>
+#include <cstring>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <thread>
+#include <ros/ros.h>
+#include <std_msgs/Float64MultiArray.h>
+
+namespace pathplan
+{
+/* Helpers for loops running with absolute deadlines on CLOCK_MONOTONIC */
+bool setRealTimePriority(const int& priority);  //SCHED_FIFO for the calling thread
+bool lockMemory();                              //lock current and future pages in RAM
+void addNanoseconds(timespec& t, const long& ns);
+double timespecDiff(const timespec& t1, const timespec& t0); //t1-t0 in seconds
+bool setThreadAffinity(const pthread_t& thread, const std::vector<int>& cpus); //threads created afterwards by this thread inherit the mask
+
+class LoopTimingStatistics;
+typedef std::shared_ptr<LoopTimingStatistics> LoopTimingStatisticsPtr;
+
+/* Wake-up jitter histogram and overrun counter of a periodic loop.
+ * Message data (times in microseconds): [cycles, overruns, mean jitter, max jitter, max cycle duration, histogram bins..].
+ * The last bin of the histogram collects all the jitters above n_bins*bin_width. */
+class LoopTimingStatistics
+{
+protected:
+  double bin_width_;
+  double max_jitter_;
+  double sum_jitter_;
+  double max_duration_;
+  unsigned long cycles_;
+  unsigned long overruns_;
+  std::vector<double> histogram_;
+  std_msgs::Float64MultiArray msg_;
+
+public:
+  LoopTimingStatistics(const unsigned int& n_bins, const double& bin_width);
+
+  void addCycle(const double& jitter, const double& duration, const bool& overrun);
+  const std_msgs::Float64MultiArray& toMsg();
+  void reset();
+};
+}
+
+#endif // REAL_TIME_UTILS_H__
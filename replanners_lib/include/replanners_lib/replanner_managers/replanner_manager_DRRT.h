@@ -12,9 +12,13 @@ typedef std::shared_ptr<ReplannerManagerDRRT> ReplannerManagerDRRTPtr;
 class ReplannerManagerDRRT: public ReplannerManagerBase
 {
 protected:
+  int regrow_batch_size_;
+  double orphan_bias_;
 
   virtual bool haveToReplan(const bool path_obstructed) override;
   virtual void initReplanner() override;
+  virtual void splitCoreBudget() override;
+  void DRRTadditionalParams();
 
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -14,9 +14,12 @@ class ReplannerManagerDRRTStar: public ReplannerManagerBase
 protected:
   NodePtr old_current_node_ = nullptr;
   bool is_a_new_node_;
+  int rewire_n_threads_;
 
   bool haveToReplan(const bool path_obstructed) override;
   void initReplanner() override;
+  void splitCoreBudget() override;
+  void DRRTStarAdditionalParams();
 
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -24,16 +24,24 @@ protected:
   std::mutex other_paths_mtx_;
   std::vector<PathPtr> other_paths_;
   std::vector<PathPtr> other_paths_shared_;
+  std::vector<PathSnapshotPtr> other_paths_snapshot_;
   std::vector<bool> other_paths_sync_needed_;
+  std::vector<unsigned long> other_paths_version_;                //replanning thread, incremented when other_paths_shared_ is re-cloned
+  std::vector<std::vector<ConnectionPtr>> other_paths_conns_;     //connections of other_paths_ at other_paths_version_
+  std::vector<unsigned long> cc_other_paths_version_;             //collision check thread
+  std::vector<std::vector<double>> cc_other_paths_costs_;         //collision check thread
 
   bool checkPathTask(const PathPtr& path);
   void MARSadditionalParams();
   void displayCurrentPath();
   void displayOtherPaths();
   void downloadPathCost() override;
+  void applyCostDelta(const CostDelta& delta) override;
+  void syncPathCost() override;
   bool uploadPathsCost(const PathPtr& current_path_updated_copy, const std::vector<PathPtr>& other_paths_updated_copy);
   void displayThread() override;
   bool haveToReplan(const bool path_obstructed) override;
+  void applyFallbackLevel(const int& level) override;
   virtual void updateSharedPath() override;
   virtual void attributeInitialization() override;
 
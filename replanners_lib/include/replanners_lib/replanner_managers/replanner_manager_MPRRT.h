@@ -13,9 +13,14 @@ class ReplannerManagerMPRRT: public ReplannerManagerBase
 {
 protected:
   int n_threads_replan_;
+  bool shared_tree_;
+  int shared_tree_capacity_;
+  bool tree_reuse_;
+  int max_reused_tree_nodes_;
 
   bool haveToReplan(const bool path_obstructed) override;
   void initReplanner() override;
+  void splitCoreBudget() override;
   void additionalParams();
 
 public:
@@ -12,9 +12,27 @@ typedef std::shared_ptr<ReplannerManagerAnytimeDRRT> ReplannerManagerAnytimeDRRT
 class ReplannerManagerAnytimeDRRT: public ReplannerManagerDRRT
 {
 protected:
+  /* Background improver: while the path is free, it improves the current path from a configuration improver_lookahead_
+   * (fraction of the path length) ahead of the replanning configuration, with its own AnytimeRRT solver and checker.
+   * The best improvement is handed to the replanning thread, which splices it into the current path if the path has
+   * not changed meanwhile and the improvement is still valid. It is paused while the path is obstructed and at the
+   * fallback level 2 */
+  bool background_improvement_;
+  double improver_lookahead_;
+  std::thread improver_thread_;
+  std::mutex improver_mtx_;
+  std::atomic<bool> improver_pause_;
+  PathPtr improver_candidate_;
+  unsigned long improver_candidate_version_;
 
   bool haveToReplan(const bool path_obstructed) override;
+  void splitCoreBudget() override;
+  void applyFallbackLevel(const int& level) override;
   void initReplanner() override;
+  bool replan() override;
+  void improverThread();
+  PathPtr spliceImprovement(const PathPtr& improvement);
+  void anytimeAdditionalParams();
 
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -23,6 +41,8 @@ public:
                               const TreeSolverPtr &solver,
                               const ros::NodeHandle &nh);
 
+  bool run() override;
+  bool joinThreads() override;
 };
 
 }
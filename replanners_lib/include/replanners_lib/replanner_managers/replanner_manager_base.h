@@ -1,14 +1,23 @@
 #ifndef REPLANNER_MANAGER_BASE_H__
 #define REPLANNER_MANAGER_BASE_H__
 
+#include <set>
 #include <mutex>
+#include <atomic>
 #include <thread>
+#include <random>
+#include <numeric>
 #include <std_msgs/Int64.h>
 #include <condition_variable>
 #include <std_msgs/ColorRGBA.h>
 #include <boost/filesystem.hpp>
 #include <replanners_lib/trajectory.h>
+#include <replanners_lib/kinematic_chain.h>
+#include <replanners_lib/real_time_utils.h>
+#include <replanners_lib/spsc_queue.h>
+#include <replanners_lib/path_snapshot.h>
 #include <jsk_rviz_plugins/OverlayText.h>
+#include <geometric_shapes/shape_operations.h>
 #include <object_loader_msgs/AddObjects.h>
 #include <object_loader_msgs/MoveObjects.h>
 #include <object_loader_msgs/RemoveObjects.h>
@@ -19,6 +28,17 @@
 
 namespace pathplan
 {
+/* Cost of a connection computed by the collision check thread.
+ * Connections are identified by their index in the path at path_version */
+struct CostDelta
+{
+  unsigned int  path_id      ; //0 current path, i+1 i-th other path
+  unsigned long path_version ;
+  unsigned int  conn_id      ;
+  double        cost         ;
+  unsigned long world_version; //planning scene update the cost refers to
+};
+
 class ReplannerManagerBase;
 typedef std::shared_ptr<ReplannerManagerBase> ReplannerManagerBasePtr;
 
@@ -26,6 +46,8 @@ class ReplannerManagerBase: public std::enable_shared_from_this<ReplannerManager
 {
 
 #define K_OFFSET 1.5
+#define COST_DELTAS_QUEUE_SIZE 4096
+#define PATH_OPTIMIZER_MAX_FAILURES 50 //consecutive failed shortcuts after which optimizePathAhead stops shortcutting
 
 protected:
 
@@ -35,6 +57,8 @@ protected:
   double               dt_replan_                         ;
   PathPtr              current_path_                      ;
   PathPtr              current_path_shared_               ;
+  PathSnapshotPtr      current_path_snapshot_             ; //read-only copy of current_path_shared_ handed to the other threads
+  PathIndexPtr         current_path_shared_index_         ; //index of current_path_shared_, costs updated by the collision check thread
   std::string          group_name_                        ;
   TreeSolverPtr        solver_                            ;
   ros::NodeHandle      nh_                                ;
@@ -46,7 +70,6 @@ protected:
   bool spawn_objs_                ;
   bool read_safe_scaling_         ;
   bool replanning_enabled_        ;
-  bool download_scene_info_       ;
   bool replanner_verbosity_       ;
   bool display_replan_config_     ;
   bool display_current_config_    ;
@@ -55,10 +78,38 @@ protected:
   bool current_path_sync_needed_  ;
   bool display_current_trj_point_ ;
   bool display_replanning_success_;
+  bool real_time_enabled_         ;
+  bool real_time_lock_memory_     ;
+  std::atomic<bool> download_scene_info_; //the scene and the path costs refer to the last path found, read by the replanning and improver threads
+  bool path_optimizer_enabled_    ;
+  bool path_optimizer_local_      ;
+  bool fallback_enabled_          ;
+  bool fallback_stop_and_wait_    ;
 
   int spline_order_              ;
   int parallel_checker_n_threads_;
   int direction_change_          ;
+  int real_time_priority_        ;
+  int timing_stats_n_bins_       ;
+  int core_budget_               ;
+  int sample_reservoir_size_     ;
+  int free_reservoir_size_       ;
+  int checker_cc_n_threads_      ;
+  int checker_replanning_n_threads_;
+  int n_replanning_checkers_     ; //replanning checker and clones working at the same time, set by splitCoreBudget
+
+  /* Fallback cascade: after fallback_overruns_ consecutive overruns of the replanning cycle the level increases (0 full settings,
+   * 1 reduced replanning time, 2 direct connection or stop and wait), after fallback_fits_ consecutive cycles within
+   * the budget it decreases */
+  int fallback_level_            ;
+  int fallback_overruns_         ;
+  int fallback_fits_             ;
+  int consecutive_overruns_      ;
+  int consecutive_fits_          ;
+  std::atomic<bool> fallback_hold_; //stop and wait, the trajectory execution thread scales the trajectory to zero
+
+  unsigned long replanning_allocations_; //Nodes and Connections allocated by the replanning thread in the last replanning
+  unsigned long replanning_reused_     ;
 
   double t_                          ;
   double dt_                         ;
@@ -75,6 +126,14 @@ protected:
   double global_override_            ;
   double obj_vel_                    ;
   double dt_move_                    ;
+  double timing_stats_period_        ;
+  double timing_stats_bin_width_     ;
+  double core_budget_cc_share_       ;
+  double free_reservoir_bias_        ;
+  double path_optimizer_min_impr_    ;
+  double fallback_time_scale_        ;
+  double replanner_max_time_         ; //max time given to the replanner at the current fallback level
+  double replanning_wait_timeout_    ;
 
   ros::WallTime tic_trj_;
 
@@ -83,14 +142,18 @@ protected:
   Eigen::VectorXd                           configuration_replan_        ;
   CollisionCheckerPtr                       checker_cc_                  ;
   CollisionCheckerPtr                       checker_replanning_          ;
+  PathLocalOptimizerPtr                     path_local_optimizer_        ;
   TrajectoryPtr                             trajectory_                  ;
   NodePtr                                   path_start_                  ;
+  SampleReservoirPtr                        sample_reservoir_            ;
+  FreeConfigurationReservoirPtr             free_reservoir_              ;
   planning_scene::PlanningScenePtr          planning_scn_cc_             ;
   planning_scene::PlanningScenePtr          planning_scn_replanning_     ;
   trajectory_processing::SplineInterpolator interpolator_                ;
   trajectory_msgs::JointTrajectoryPoint     pnt_                         ;
   trajectory_msgs::JointTrajectoryPoint     pnt_unscaled_                ;
   trajectory_msgs::JointTrajectoryPoint     pnt_replan_                  ;
+  trajectory_msgs::JointTrajectoryPoint     pnt_trj_                     ; //start of the last trajectory computed by the replanning thread
   sensor_msgs::JointState                   new_joint_state_unscaled_    ;
   sensor_msgs::JointState                   new_joint_state_             ;
   moveit_msgs::PlanningScene                planning_scene_msg_          ;
@@ -116,19 +179,44 @@ protected:
   std::mutex ovr_mtx_         ;
   std::mutex bench_mtx_       ;
 
+  std::atomic<bool> trj_exec_path_sync_needed_; //the trajectory execution thread has to clone current_path_shared_ again
+
+  /* Path costs flow from the collision check thread to the replanning thread as CostDelta */
+  std::shared_ptr<SPSCQueue<CostDelta>> cost_deltas_         ;
+  std::atomic<bool>                     cost_deltas_overflow_; //some deltas were lost, a full sync is needed
+  unsigned long                         world_version_       ; //collision check thread, incremented when the world of the planning scene changes
+  unsigned long                         cost_world_version_  ; //replanning thread, world version of the last delta applied
+  unsigned long                         planning_scene_diff_world_version_; //world version of planning_scene_diff_msg_
+  unsigned long                         current_path_version_; //incremented by updateSharedPath
+  std::vector<ConnectionPtr>            current_path_conns_  ; //connections of current_path_ at current_path_version_
+  unsigned long                         cc_path_version_     ; //version of the collision check thread copy of the path
+  int                                   cc_conn_hint_        ; //connection of the current configuration at the last check
+  std::vector<double>                   cc_path_costs_       ; //costs last uploaded by the collision check thread
+  std::map<std::string,Eigen::AlignedBox3d> cc_objects_boxes_; //world objects at the last world change, see recordWorldChange
+
+  /* Signalled by the collision check thread when new path cost information is available */
+  std::mutex              scene_update_mtx_;
+  std::condition_variable scene_update_cv_ ;
+  unsigned long           scene_update_id_ ;
+
   std::vector<std::string>                                                        scaling_topics_names_ ;
   std::vector<std::shared_ptr<ros_helper::SubscriptionNotifier<std_msgs::Int64>>> scaling_topics_vector_;
   std::map<std::string,double> overrides_;
+  std::map<std::string,std::vector<int>> cpu_affinity_; //thread name -> cpus the thread is pinned to
 
   ros::Publisher target_pub_         ;
   ros::Publisher obj_pose_pub_       ;
   ros::Publisher text_overlay_pub_   ;
   ros::Publisher unscaled_target_pub_;
+  ros::Publisher trj_exec_timing_pub_;
 
   std::string obs_pose_topic_             ;
   std::string joint_target_topic_         ;
   std::string unscaled_joint_target_topic_;
   std::string which_link_display_path_    ;
+  std::string timing_stats_topic_         ;
+
+  std::minstd_rand optimizer_gen_;
 
   ros::ServiceClient add_obj_               ;
   ros::ServiceClient move_obj_              ;
@@ -143,6 +231,13 @@ protected:
   virtual void updateSharedPath();
   virtual bool updateTrajectory();
   virtual bool uploadPathCost(const PathPtr& current_path_updated_copy);
+  virtual void applyCostDelta(const CostDelta& delta);
+  virtual void syncPathCost();
+  void uploadConnectionsCost(const unsigned int& path_id, const unsigned long& path_version, const PathPtr& shared_path, const PathIndexPtr& shared_index,
+                             const PathPtr& path_updated_copy, std::vector<double>& last_costs);
+  std::vector<double> connectionsCost(const PathPtr& path);
+  PathSnapshotPtr getPathSnapshot();
+  double sharedConnectionCost(const PathSnapshotPtr& snapshot, const int& conn_idx);
   virtual void attributeInitialization();
   virtual void replanningThread();
   virtual void collisionCheckThread();
@@ -152,6 +247,30 @@ protected:
   virtual void trajectoryExecutionThread();
   virtual double readScalingTopics();
   virtual PathPtr trjPath(const PathPtr& path);
+  virtual PathPtr optimizePathAhead(const double& max_time);
+  PathPtr spliceIntoCurrentPath(const std::vector<Eigen::VectorXd>& waypoints, const std::vector<NodePtr>& nodes);
+  virtual void applyFallbackLevel(const int& level);
+  void updateFallbackLevel(const double& cycle_duration);
+  PathPtr directConnectionPath(const double& max_time);
+  void joinConfToReplannedPath(const Eigen::VectorXd& configuration); //prepend to the replanned path the current path from configuration to its start
+  virtual void splitCoreBudget();
+  void checkCoreBudget();
+  void recordWorldChange(const unsigned long& world_version);
+  void pinThread(std::thread& thread, const std::string& name);
+
+  /* Trajectory point -> configuration kernel of the replanning and trajectory execution threads, instantiated for
+   * 3, 6, 12 and 18 dof with fixed-size Eigen maps and for a dynamic number of dof (selected in attributeInitialization).
+   * It copies positions into point, which must have the group dof, and returns the distance of point from goal */
+  double (ReplannerManagerBase::*point_from_positions_)(const std::vector<double>&, const Eigen::VectorXd&, Eigen::VectorXd&) const;
+
+  template<int DOF>
+  double pointFromPositionsKernel(const std::vector<double>& positions, const Eigen::VectorXd& goal, Eigen::VectorXd& point) const;
+  double pointFromPositions(const std::vector<double>& positions, const Eigen::VectorXd& goal, Eigen::VectorXd& point) const
+  {
+    return (this->*point_from_positions_)(positions,goal,point);
+  }
+  void notifySceneUpdate();
+  bool waitSceneUpdate(unsigned long& last_update_id, const double& timeout);
   Eigen::Vector3d forwardIk(const Eigen::VectorXd& conf, const std::string& last_link, const MoveitUtils& util);
   Eigen::Vector3d forwardIk(const Eigen::VectorXd& conf, const std::string& last_link, const MoveitUtils& util, geometry_msgs::Pose &pose);
 
@@ -0,0 +1,90 @@
+#ifndef REPLANNER_MANAGER_PORTFOLIO_H__
+#define REPLANNER_MANAGER_PORTFOLIO_H__
+
+#include <future>
+#include <std_msgs/Float64MultiArray.h>
+#include <replanners_lib/replanner_managers/replanner_manager_base.h>
+#include <replanners_lib/replanners/DRRTStar.h>
+#include <replanners_lib/replanners/MPRRT.h>
+#include <replanners_lib/replanners/DRRT.h>
+#include <replanners_lib/replanners/MARS.h>
+
+namespace pathplan
+{
+class ReplannerManagerPortfolio;
+typedef std::shared_ptr<ReplannerManagerPortfolio> ReplannerManagerPortfolioPtr;
+
+/* A replanner of the portfolio, with its own solver and checker and its statistics */
+struct PortfolioMember
+{
+  std::string name;
+  ReplannerBasePtr replanner;
+  TreeSolverPtr solver;
+  CollisionCheckerPtr checker;
+  bool rebuild = false; //tree based replanners (DRRT, DRRT*) keep state bound to their path, they are built again at each cycle
+
+  unsigned long runs = 0;
+  unsigned long successes = 0;
+  unsigned long wins = 0;
+  unsigned long abandoned = 0; //runs still going at the end of the race (deadline or "first" policy), counted as timeouts
+  unsigned long timed = 0;     //runs whose replan() has returned, abandoned ones included
+  double time = 0.0;           //total time from the start of the race to the return of replan() of the timed runs
+};
+
+/* Runs several replanners on the same replanning configuration and scene at each cycle, each one on its own copy of
+ * the current path. The race ends after the replanning time: with the "best" policy the cheapest solution found by
+ * then is used, with the "first" policy the first solution found. The replanners still running are asked to stop and
+ * their results are discarded; a replanner that has not returned yet at the next cycle sits that cycle out, so it never
+ * delays the race. */
+class ReplannerManagerPortfolio: public ReplannerManagerBase
+{
+protected:
+  std::vector<std::string> replanners_names_;
+  std::vector<PortfolioMember> members_;
+  std::vector<std::future<double>> pending_; //one per member, valid while its abandoned run has not been collected
+  bool first_solution_;
+  bool replan_only_if_obstructed_;
+
+  /* Parameters of the replanners, read from the same namespaces of their own managers */
+  int n_threads_replan_;
+  bool shared_tree_;
+  int shared_tree_capacity_;
+  bool tree_reuse_;
+  int max_reused_tree_nodes_;
+  int regrow_batch_size_;
+  double orphan_bias_;
+  int rewire_n_threads_;
+  bool full_net_search_;
+
+  std::string portfolio_stats_topic_;
+  ros::Publisher portfolio_stats_pub_;
+
+  bool haveToReplan(const bool path_obstructed) override;
+  void initReplanner() override;
+  void splitCoreBudget() override;
+  bool replan() override;
+  void portfolioAdditionalParams();
+  void publishPortfolioStats();
+  bool collectPending(const unsigned int& idx, const bool& wait);
+  PathPtr isolatedPath(const PathPtr& path, const CollisionCheckerPtr& checker);
+  ReplannerBasePtr createReplanner(const std::string& name, PathPtr path, const TreeSolverPtr& solver);
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  ReplannerManagerPortfolio(const PathPtr &current_path,
+                            const TreeSolverPtr &solver,
+                            const ros::NodeHandle &nh);
+
+  bool joinThreads() override;
+  void startReplannedPathFromNewCurrentConf(const Eigen::VectorXd &configuration) override;
+
+  const std::vector<PortfolioMember>& getPortfolioStats() const
+  {
+    return members_;
+  }
+};
+
+}
+
+#endif // REPLANNER_MANAGER_PORTFOLIO_H__
@@ -1,9 +1,13 @@
 #ifndef DRRT_H__
 #define DRRT_H__
 #include <replanners_lib/replanners/replanner_base.h>
+#include <replanners_lib/worker_pool.h>
 #include <graph_core/solvers/rrt.h>
 #include <graph_core/local_informed_sampler.h>
+#include <graph_core/moveit_collision_checker.h>
 #include <typeinfo>
+#include <future>
+#include <random>
 
 //Replanning with RRTs
 
@@ -20,9 +24,23 @@ protected:
   bool tree_is_trimmed_;
   InformedSamplerPtr sampler_;
   std::vector<ConnectionPtr> checked_connections_;
+  unsigned int regrow_batch_size_;
+  std::vector<CollisionCheckerPtr> batch_checkers_;
+  CollisionCheckerPtr batch_checkers_source_;       //checker the batch checkers are clones of
+  unsigned long batch_checkers_world_version_;      //world version of the scene loaded in the batch checkers
+  WorkerPoolPtr batch_pool_;                        //regrow_batch_size_-1 threads, the replanning thread works too
+  std::vector<Eigen::VectorXd> orphan_seeds_; //configurations of the nodes purged by the last trimming
+  double orphan_bias_;
+  std::mt19937 gen_;
+  std::uniform_real_distribution<double> ud_;
+  std::normal_distribution<double> nd_;
 
   virtual bool trimInvalidTree(NodePtr& node);
   virtual bool regrowRRT(NodePtr& node);
+  void regrowBatch(const NodePtr& node, const double& max_distance, const ros::WallTime& tic);
+  void connectReplanNode(const NodePtr& new_node, const NodePtr& node);
+  void addOrphanSeeds(const NodePtr& subtree_root);
+  Eigen::VectorXd sampleRegrow(const double& max_distance);
   bool replan(const double& cost_from_conf);
   void fixTree(const NodePtr& node_replan, const NodePtr& root, std::vector<NodePtr> &old_nodes, std::vector<double> &old_connections_costs);
 public:
@@ -38,6 +56,17 @@ public:
     return tree_is_trimmed_;
   }
 
+  /* Number of samples extended and validated in parallel at each regrow step, 1 to extend the tree one sample at a time.
+   * Each parallel validation uses its own clone of the checker */
+  void setRegrowBatchSize(const unsigned int& batch_size);
+
+  /* Probability of drawing the regrow samples around the nodes purged by the trimming (the orphaned branches, which
+   * contain the replanning node) instead of over the whole joint space */
+  void setOrphanBias(const double& orphan_bias)
+  {
+    orphan_bias_ = std::max(0.0,std::min(1.0,orphan_bias));
+  }
+
   virtual bool replan() override;
 };
 }
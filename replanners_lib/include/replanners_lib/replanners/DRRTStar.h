@@ -3,6 +3,8 @@
 #include <replanners_lib/replanners/replanner_base.h>
 #include <graph_core/solvers/rrt_star.h>
 #include <graph_core/local_informed_sampler.h>
+#include <graph_core/moveit_collision_checker.h>
+#include <replanners_lib/cached_collision_checker.h>
 
 //Dynamic path planning and replanning for mobile robots using RRT*
 
@@ -14,7 +16,29 @@ typedef std::shared_ptr<DynamicRRTStar> DynamicRRTStarPtr;
 class DynamicRRTStar: public ReplannerBase
 {
 protected:
+  unsigned int rewire_n_threads_;
+  std::vector<CollisionCheckerPtr> rewire_checkers_;
+  CollisionCheckerPtr rewire_checkers_source_;      //checker the rewire checkers are clones of
+  unsigned long rewire_checkers_world_version_;     //world version of the scene loaded in the rewire checkers
+  WorkerPoolPtr rewire_pool_;                       //rewire_n_threads_-1 threads, the replanning thread works too
+  CachedCollisionCheckerPtr cached_checker_;
 
+  /* Local replanning region (obstructed part of the path between region_start_ and region_goal_) kept across the
+   * replanning cycles: while the region and the world do not change, the next cycles skip the rewiring of the region
+   * start and continue sampling the same ball, refining the nodes added by the previous cycles */
+  NodePtr region_start_;
+  NodePtr region_goal_;
+  TreePtr region_tree_;
+  unsigned long region_world_version_;
+  InformedSamplerPtr region_sampler_;
+  bool region_rewired_;
+
+  bool sameRegion(const TreePtr& tree, const NodePtr& replan_start, const NodePtr& replan_goal);
+
+  /* closest_node is the node configuration would be connected to when it is a new node, nullptr when configuration is
+   * already a node of the subtree with cost-to-come cost2configuration */
+  void prefetchRewireChecks(const SubtreePtr& subtree, const Eigen::VectorXd& configuration, const double& radius,
+                            const NodePtr& closest_node, const double& cost2configuration = 0.0);
   bool nodeBeforeObs(const PathPtr& subpath, NodePtr& node_before);
   bool nodeBehindObs(NodePtr& node_behind);
   bool connectBehindObs(const NodePtr &node);
@@ -27,6 +51,15 @@ public:
                  const double& max_time,
                  const TreeSolverPtr &solver);
 
+  /* Number of threads checking concurrently the candidate connections of each rewire step, 1 to check them serially.
+   * Each thread uses its own clone of the checker */
+  void setRewireThreads(const unsigned int& n_threads)
+  {
+    rewire_n_threads_ = std::max(1u,n_threads);
+    rewire_checkers_.clear(); //cloned at the first replanning
+    rewire_pool_ = nullptr;
+  }
+
   bool replan() override;
 };
 }
@@ -1,5 +1,6 @@
 #ifndef MARS_H__
 #define MARS_H__
+#include <typeinfo>
 #include <replanners_lib/replanners/replanner_base.h>
 #include <graph_core/graph/net.h>
 
@@ -86,6 +87,12 @@ protected:
   virtual void clearInvalidConnections();
   virtual void clearFlaggedConnections();
   virtual std::vector<ps_goal_ptr> sortNodes(const NodePtr& node);
+
+  /* Distances of the nodes from a configuration, instantiated for 3, 6, 12 and 18 dof with fixed-size Eigen maps and
+   * for a dynamic number of dof, selected at construction */
+  void (MARS::*nodes_distance_)(const Eigen::VectorXd&, const std::vector<NodePtr>&, std::vector<double>&) const;
+  template<int DOF>
+  void nodesDistanceKernel(const Eigen::VectorXd& configuration, const std::vector<NodePtr>& nodes, std::vector<double>& distances) const;
   virtual std::vector<NodePtr> startNodes(const std::vector<ConnectionPtr>& subpath1_conn);
   virtual bool computeConnectingPath(const NodePtr &path1_node_fake, const NodePtr &path2_node, const double &diff_subpath_cost, const PathPtr &current_solution, const ros::WallTime &tic, const ros::WallTime &tic_cycle, PathPtr &connecting_path, bool &quickly_solved);
 
@@ -243,4 +250,4 @@ public:
 };
 }
 
-#endif // MARS_H
\ No newline at end of file
+#endif // MARS_H
\ No newline at end of file
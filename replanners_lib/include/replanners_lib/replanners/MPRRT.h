@@ -4,8 +4,13 @@
 #include <graph_core/moveit_collision_checker.h>
 #include <graph_core/parallel_moveit_collision_checker.h>
 #include <graph_core/solvers/rrt.h>
-#include <future>
+#include <replanners_lib/concurrent_tree.h>
+#include <replanners_lib/worker_pool.h>
 #include <mutex>
+#include <atomic>
+
+#define SHARED_TREE_CAPACITY 20000 //default
+#define MAX_REUSED_TREE_NODES 10000 //default
 
 //High-frequency replanning under uncertainty using parallel sampling-based motion planning
 
@@ -22,10 +27,35 @@ protected:
   std::vector<PathPtr> connecting_path_vector_;
   std::mutex mtx_;
 
+  /* The parallel plannings run on persistent threads (plus the calling one), so the graph pool free lists of the
+   * workers survive across replans */
+  WorkerPoolPtr pool_;
+
+  /* Shared tree mode: the parallel plannings extend a single ConcurrentTree from path1_node towards the goal instead of
+   * growing one RRT each, the best connection to the goal found by any of them is kept */
+  bool shared_tree_;
+  double shared_tree_max_distance_;
+  unsigned int shared_tree_capacity_;
+  ConcurrentTreePtr concurrent_tree_;
+  int shared_tree_best_idx_;
+  std::atomic<double> shared_tree_best_cost_; //read by each thread at every iteration, written under mtx_
+
+  /* Tree reuse: each parallel planning keeps its tree across iterations and replanning cycles. When the world changes the
+   * invalid branches are pruned, then the tree is re-rooted at the new replanning node */
+  bool tree_reuse_;
+  unsigned int max_reused_tree_nodes_; //larger trees are discarded, their nearest neighbour searches are too slow
+  std::vector<TreePtr> worker_trees_;
+  std::vector<NodePtr> worker_goals_;
+  std::vector<unsigned long> worker_trees_world_version_;
+
   PathPtr concatWithNewPathToGoal(const std::vector<ConnectionPtr>& connecting_path_conn, const NodePtr& path1_node);
   bool asyncComputeConnectingPath(const Eigen::VectorXd path1_node_conf, const Eigen::VectorXd path2_node_conf, const double current_solution_cost, const int index);
   bool computeConnectingPath(const NodePtr &path1_node_fake, const NodePtr &path2_node_fake, const double &current_solution_cost, const double max_time, PathPtr &connecting_path, bool &directly_connected, TreeSolverPtr &solver);
+  bool computeConnectingPathReusingTree(const NodePtr &path1_node_fake, const NodePtr &path2_node_fake, const double &current_solution_cost, const double max_time, PathPtr &connecting_path, bool &directly_connected, const int index);
+  TreePtr reuseTree(const NodePtr& start_node, const double& max_time, const int index);
   bool connect2goal(const NodePtr& node);
+  void asyncGrowSharedTree(const Eigen::VectorXd goal_conf, const double current_solution_cost, const int index);
+  PathPtr sharedTreeConnectingPath(const Eigen::VectorXd& path1_node_conf, const Eigen::VectorXd& path2_node_conf, const double& current_solution_cost);
 
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -36,6 +66,19 @@ public:
                   const TreeSolverPtr& solver,
                   const unsigned int& number_of_parallel_plannings = 1);
 
+  void setSharedTree(const bool& shared_tree, const double& max_distance, const unsigned int& capacity = SHARED_TREE_CAPACITY)
+  {
+    shared_tree_ = shared_tree;
+    shared_tree_max_distance_ = max_distance;
+    shared_tree_capacity_ = std::max(1u,capacity);
+  }
+
+  void setTreeReuse(const bool& tree_reuse, const unsigned int& max_reused_tree_nodes = MAX_REUSED_TREE_NODES)
+  {
+    tree_reuse_ = tree_reuse;
+    max_reused_tree_nodes_ = std::max(1u,max_reused_tree_nodes);
+  }
+
   bool replan() override;
 };
 }
@@ -25,6 +25,10 @@ public:
                     const double& max_time,
                     const TreeSolverPtr &solver);
 
+  /* Make path, improved outside replan() (e.g. by a background improver), the replanned path as if found by replan().
+   * The path must have its own tree */
+  void setImprovedPath(const PathPtr& path);
+
   bool replan() override;
 };
 }
@@ -1,6 +1,7 @@
 #ifndef REPLANNERBASE_H__
 #define REPLANNERBASE_H__
 
+#include <atomic>
 #include <ros/ros.h>
 #include <eigen3/Eigen/Core>
 #include <graph_core/util.h>
@@ -13,6 +14,10 @@
 #include <graph_core/graph/graph_display.h>
 #include <graph_core/solvers/tree_solver.h>
 #include <graph_core/solvers/path_solver.h>
+#include <graph_core/local_informed_sampler.h>
+#include <replanners_lib/graph_pool.h>
+#include <replanners_lib/sample_reservoir.h>
+#include <replanners_lib/free_configuration_reservoir.h>
 
 namespace pathplan
 {
@@ -37,6 +42,26 @@ protected:
   bool success_;
   bool verbose_;
   double max_time_;
+  std::atomic<bool> stop_; //set from another thread to end replan() early, polled together with max_time_
+  unsigned long world_version_; //version of the scene of checker_, changes only when the world changes
+  SampleReservoirPtr sample_reservoir_; //shared precomputed samples, nullptr to use the pseudo-random samplers
+  FreeConfigurationReservoirPtr free_reservoir_; //free configurations shared across replans, nullptr if not used
+  double free_reservoir_bias_;
+
+  /* Informed sampler between start and goal, drawing from sample_reservoir_ when available. With a free configuration
+   * reservoir, a fraction of the samples is taken from it (checker validates those found in a different world version,
+   * checker_ if nullptr) */
+  InformedSamplerPtr makeInformedSampler(const Eigen::VectorXd& start, const Eigen::VectorXd& goal,
+                                         const double& cost = std::numeric_limits<double>::infinity(),
+                                         const CollisionCheckerPtr& checker = nullptr);
+
+  /* Store (at most FREE_RESERVOIR_MAX_ADD of) the configurations of nodes validated in the current world */
+  void storeFreeConfigurations(const std::vector<NodePtr>& nodes);
+
+  /* As makeInformedSampler, but the samples are restricted to a ball */
+  InformedSamplerPtr makeLocalSampler(const Eigen::VectorXd& start, const Eigen::VectorXd& goal,
+                                      const Eigen::VectorXd& ball_center, const double& ball_radius,
+                                      const double& cost = std::numeric_limits<double>::infinity());
 
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -74,6 +99,43 @@ public:
     max_time_ = max_time;
   }
 
+  /* Ask a running replan() to return as soon as possible, as if its time was over */
+  void requestStop()
+  {
+    stop_ = true;
+  }
+
+  void resetStop()
+  {
+    stop_ = false;
+  }
+
+  bool stopRequested() const
+  {
+    return stop_;
+  }
+
+  void setWorldVersion(const unsigned long& world_version)
+  {
+    world_version_ = world_version;
+  }
+
+  unsigned long getWorldVersion() const
+  {
+    return world_version_;
+  }
+
+  void setSampleReservoir(const SampleReservoirPtr& reservoir)
+  {
+    sample_reservoir_ = reservoir;
+  }
+
+  void setFreeConfigurationReservoir(const FreeConfigurationReservoirPtr& reservoir, const double& bias)
+  {
+    free_reservoir_ = reservoir;
+    free_reservoir_bias_ = bias;
+  }
+
   virtual void setVerbosity(const bool& verbose)
   {
     verbose_ = verbose;
@@ -0,0 +1,144 @@
+#ifndef SAMPLE_RESERVOIR_H__
+#define SAMPLE_RESERVOIR_H__
+
+#include <cmath>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+#include <stdexcept>
+#include <eigen3/Eigen/Core>
+#include <graph_core/sampler.h>
+
+#define MAX_RESERVOIR_TRIES 20
+
+namespace pathplan
+{
+class SampleReservoir;
+typedef std::shared_ptr<SampleReservoir> SampleReservoirPtr;
+
+class ReservoirInformedSampler;
+typedef std::shared_ptr<ReservoirInformedSampler> ReservoirInformedSamplerPtr;
+
+/* Low-discrepancy samples precomputed once and shared by the samplers of the replanners.
+ * Two tables are stored (column i is the i-th sample): points of a scrambled Halton sequence in the unit cube and
+ * points uniformly distributed in the unit ball (Box-Muller directions plus radius from further Halton dimensions).
+ * The tables are read-only after construction, the cursor is atomic so samplers running in different threads can draw
+ * from the same reservoir. The cursor wraps around the tables: each sampler randomizes the samples it reads (see
+ * ReservoirInformedSampler), so the same index gives different points to different samplers and at each pass. */
+class SampleReservoir
+{
+protected:
+  unsigned int dof_;
+  unsigned int size_;
+  Eigen::MatrixXd cube_;
+  Eigen::MatrixXd ball_;
+  std::atomic<unsigned long> cursor_;
+
+  static double radicalInverse(unsigned int index, const unsigned int& base);
+  static std::vector<unsigned int> primes(const unsigned int& n);
+
+public:
+  SampleReservoir(const unsigned int& dof, const unsigned int& size, const unsigned int& seed = 0);
+
+  /* Index of the next sample to use, pass is the number of times the cursor has wrapped around the tables */
+  unsigned int next(unsigned long& pass)
+  {
+    unsigned long cursor = cursor_.fetch_add(1,std::memory_order_relaxed);
+    pass = cursor/size_;
+    return cursor%size_;
+  }
+
+  unsigned int next()
+  {
+    unsigned long pass;
+    return next(pass);
+  }
+
+  Eigen::MatrixXd::ConstColXpr getUnitCube(const unsigned int& idx) const
+  {
+    return cube_.col(idx);
+  }
+
+  Eigen::MatrixXd::ConstColXpr getUnitBall(const unsigned int& idx) const
+  {
+    return ball_.col(idx);
+  }
+
+  unsigned int getDof() const
+  {
+    return dof_;
+  }
+
+  unsigned int getSize() const
+  {
+    return size_;
+  }
+};
+
+/* InformedSampler drawing from a SampleReservoir. The points of the unit ball are mapped into the informed ellipsoid
+ * (or into the balls added with addBall) with an affine transform, instead of rejecting random samples. Only the
+ * samples outside the bounds (or outside the ellipsoid, when sampling the balls or an ellipsoid larger than the bounds)
+ * are discarded, after MAX_RESERVOIR_TRIES the sample is drawn by the rejection sampling of InformedSampler.
+ * Each sampler randomizes the reservoir with its own Cranley-Patterson shift of the unit cube and random rotation of the
+ * unit ball, both drawn again whenever the reservoir cursor starts a new pass: the samplers sharing a reservoir do not
+ * draw the same points, and a sampler does not repeat its points when the cursor wraps around. */
+class ReservoirInformedSampler: public InformedSampler
+{
+protected:
+  SampleReservoirPtr reservoir_;
+
+  Eigen::VectorXd focus1_;
+  Eigen::VectorXd focus2_;
+  Eigen::VectorXd center_;
+  Eigen::VectorXd direction_;
+  Eigen::VectorXd box_lb_;
+  Eigen::VectorXd box_range_;
+  double focii_dist_;
+  double ellipse_cost_;
+  double major_radius_;
+  double minor_radius_;
+  bool informed_;
+  bool sample_box_;
+
+  std::vector<Eigen::VectorXd> balls_centers_;
+  std::vector<double> balls_radii_;
+  std::minstd_rand ball_gen_;
+
+  Eigen::VectorXd cube_shift_;
+  Eigen::MatrixXd ball_rotation_;
+  unsigned long pass_;
+
+  void randomize();
+
+  bool inEllipse(const Eigen::VectorXd& q) const
+  {
+    return ((q-focus1_).norm()+(q-focus2_).norm())<=ellipse_cost_;
+  }
+
+  bool inBox(const Eigen::VectorXd& q) const
+  {
+    return ((q-box_lb_).array()>=0.0).all() && ((q-box_lb_-box_range_).array()<=0.0).all();
+  }
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  ReservoirInformedSampler(const Eigen::VectorXd& start_configuration,
+                           const Eigen::VectorXd& stop_configuration,
+                           const Eigen::VectorXd& lower_bound,
+                           const Eigen::VectorXd& upper_bound,
+                           const SampleReservoirPtr& reservoir,
+                           const double& cost = std::numeric_limits<double>::infinity());
+
+  virtual Eigen::VectorXd sample() override;
+  virtual void setCost(const double& cost) override;
+
+  void addBall(const Eigen::VectorXd& center, const double& radius);
+  void clearBalls();
+};
+
+}
+
+#endif // SAMPLE_RESERVOIR_H__
@@ -0,0 +1,75 @@
+#ifndef SPSC_QUEUE_H__
+#define SPSC_QUEUE_H__
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace pathplan
+{
+/* Lock-free bounded queue for one producer thread and one consumer thread.
+ * The capacity is rounded up to a power of two, push() fails when the queue is full. */
+template<typename T>
+class SPSCQueue
+{
+protected:
+  std::vector<T> buffer_;
+  size_t mask_;
+
+  alignas(64) std::atomic<size_t> head_; //next element to pop, written only by the consumer
+  alignas(64) std::atomic<size_t> tail_; //next free slot, written only by the producer
+
+public:
+  SPSCQueue(const size_t& capacity)
+  {
+    size_t size = 1;
+    while(size<capacity)
+      size = size<<1;
+
+    buffer_.resize(size);
+    mask_ = size-1;
+
+    head_ = 0;
+    tail_ = 0;
+  }
+
+  /* Producer side */
+  bool push(const T& element)
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if(tail-head_.load(std::memory_order_acquire) == buffer_.size())
+      return false;
+
+    buffer_[tail & mask_] = element;
+    tail_.store(tail+1,std::memory_order_release);
+
+    return true;
+  }
+
+  /* Consumer side */
+  bool pop(T& element)
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if(head == tail_.load(std::memory_order_acquire))
+      return false;
+
+    element = buffer_[head & mask_];
+    head_.store(head+1,std::memory_order_release);
+
+    return true;
+  }
+
+  /* Consumer side, discards all the elements pushed so far */
+  void clear()
+  {
+    head_.store(tail_.load(std::memory_order_acquire),std::memory_order_release);
+  }
+
+  size_t capacity() const
+  {
+    return buffer_.size();
+  }
+};
+}
+
+#endif // SPSC_QUEUE_H__
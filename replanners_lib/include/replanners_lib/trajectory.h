@@ -19,6 +19,7 @@
 #include <replanners_lib/moveit_utils.h>
 
 #define COMMENT(...) ROS_LOG(::ros::console::levels::Debug, ROSCONSOLE_DEFAULT_NAME, __VA_ARGS__);
+#define ARC_LENGTH_TABLE_SUBSAMPLES 10 //samples of the spline between two waypoints when spline_order>1
 
 namespace pathplan
 {
@@ -36,6 +37,30 @@ protected:
   planning_scene::PlanningScenePtr planning_scene_;  //REMOVE
   std::string group_name_;
   MoveitUtilsPtr moveit_utils_;
+  std::vector<moveit::core::RobotState> wp_state_vector_; //reused by fromPath2Trj
+
+  /* Arc-length -> time lookup table, built once per trajectory by sampling the interpolated trj_ (see computeArcLengthTable) */
+  int table_spline_order_;
+  int table_hint_;                         //segment found by the previous projection
+  double table_tolerance_;                 //max distance of the trajectory from the polyline of the samples
+  robot_trajectory::RobotTrajectoryPtr table_trj_; //trajectory the table has been built for
+  std::vector<double> table_times_;
+  std::vector<double> table_abscissa_;     //cumulative length of the polyline at each sample
+  Eigen::MatrixXd table_points_;           //dof x n_samples
+  Eigen::MatrixXd table_segments_;         //dof x n_samples-1
+  Eigen::ArrayXd table_segments_sq_length_;
+  trajectory_processing::SplineInterpolator table_interpolator_;
+
+  void computeArcLengthTable(const int& spline_order);
+  double projectOnArcLengthTable(const Eigen::VectorXd& point);
+  bool updateArcLengthTable(const int& spline_order);
+  void clearArcLengthTable()
+  {
+    table_trj_ = nullptr;
+    table_hint_ = 0;
+    table_times_.clear();
+    table_abscissa_.clear();
+  }
 
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -60,6 +85,7 @@ public:
       throw std::runtime_error("path is nullptr");
 
     path_ = path;
+    clearArcLengthTable();
   }
 
   pathplan::PathPtr getPath()
@@ -84,7 +110,12 @@ public:
   robot_trajectory::RobotTrajectoryPtr fromPath2Trj(const trajectory_msgs::JointTrajectoryPointPtr& pnt = nullptr);
   robot_trajectory::RobotTrajectoryPtr fromPath2Trj(const trajectory_msgs::JointTrajectoryPoint& pnt);
 
+  /* Both use the arc-length table of the trajectory: binary search of the abscissa among the samples + n_interval bisection
+   * steps on the interpolated trajectory inside the bracketing samples. getTimeFromTrjPoint first projects trj_point on the
+   * table, starting from the segment found by the previous query; the whole table is scanned only if trj_point is farther
+   * than the sampling error from the trajectory */
   double getTimeFromTrjPoint(const Eigen::VectorXd &trj_point, const int &n_interval = 10, const int &spline_order = 1);
+  double getTimeFromAbscissa(const double &abscissa, const int &n_interval = 10, const int &spline_order = 1);
 };
 }
 
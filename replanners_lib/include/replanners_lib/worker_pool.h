@@ -0,0 +1,57 @@
+#ifndef WORKER_POOL_H__
+#define WORKER_POOL_H__
+
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace pathplan
+{
+class WorkerPool;
+typedef std::shared_ptr<WorkerPool> WorkerPoolPtr;
+
+/* Fixed set of threads, started at construction and kept alive until destruction, running the tasks of parallelFor.
+ * The calling thread works on the tasks too, so a pool of n threads runs up to n+1 tasks at the same time.
+ * Calls of parallelFor from different threads are serialized. The first exception thrown by a task is rethrown by
+ * parallelFor once all the tasks are over. */
+class WorkerPool
+{
+protected:
+  std::vector<std::thread> threads_;
+  std::mutex call_mtx_;
+  std::mutex mtx_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+
+  std::function<void(const unsigned int&)> task_;
+  unsigned int n_tasks_;
+  unsigned int next_task_;
+  unsigned int pending_;
+  std::exception_ptr exception_;
+  bool stop_;
+
+  void worker();
+  void runTasks(std::unique_lock<std::mutex>& lock);
+
+public:
+  WorkerPool(const unsigned int& n_threads);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /* Run task(0),..,task(n_tasks-1), return when all of them are over */
+  void parallelFor(const unsigned int& n_tasks, const std::function<void(const unsigned int&)>& task);
+
+  unsigned int size() const
+  {
+    return threads_.size();
+  }
+};
+}
+
+#endif // WORKER_POOL_H__
@@ -0,0 +1,76 @@
+#include "replanners_lib/concurrent_tree.h"
+
+namespace pathplan
+{
+
+ConcurrentTree::ConcurrentTree(const Eigen::VectorXd& root, const unsigned int& capacity)
+{
+  if(capacity<1)
+    throw std::invalid_argument("tree capacity must be at least 1");
+
+  dof_ = root.size();
+  capacity_ = capacity;
+
+  configurations_.resize(capacity_*dof_);
+  parents_.resize(capacity_,-1);
+  costs_.resize(capacity_,0.0);
+
+  published_.reset(new std::atomic<bool>[capacity_]);
+  for(unsigned int i=0;i<capacity_;i++)
+    published_[i].store(false,std::memory_order_relaxed);
+
+  Eigen::Map<Eigen::VectorXd>(configurations_.data(),dof_) = root;
+  published_[0].store(true,std::memory_order_release);
+  reserved_.store(1,std::memory_order_release);
+}
+
+int ConcurrentTree::add(const Eigen::VectorXd& configuration, const int& parent, const double& cost)
+{
+  unsigned int idx = reserved_.fetch_add(1,std::memory_order_acq_rel);
+  if(idx>=capacity_)
+    return -1;
+
+  Eigen::Map<Eigen::VectorXd>(configurations_.data()+idx*dof_,dof_) = configuration;
+  parents_[idx] = parent;
+  costs_[idx] = cost;
+
+  published_[idx].store(true,std::memory_order_release);  //makes the slot visible to the readers
+
+  return idx;
+}
+
+int ConcurrentTree::nearest(const Eigen::VectorXd& configuration, double& distance) const
+{
+  unsigned int n = size();
+
+  int idx = 0;
+  double d2;
+  double min_d2 = std::numeric_limits<double>::infinity();
+  for(unsigned int i=0;i<n;i++)
+  {
+    if(not published_[i].load(std::memory_order_acquire)) //reserved by a thread which is still writing it
+      continue;
+
+    d2 = (Eigen::Map<const Eigen::VectorXd>(configurations_.data()+i*dof_,dof_)-configuration).squaredNorm();
+    if(d2<min_d2)
+    {
+      min_d2 = d2;
+      idx = i;
+    }
+  }
+
+  distance = std::sqrt(min_d2);
+  return idx;
+}
+
+std::vector<int> ConcurrentTree::branch(const int& idx) const
+{
+  std::vector<int> indices;
+  for(int i=idx;i>=0;i=parents_[i])
+    indices.push_back(i);
+
+  std::reverse(indices.begin(),indices.end());
+  return indices;
+}
+
+}
@@ -0,0 +1,197 @@
+#include "replanners_lib/free_configuration_reservoir.h"
+
+namespace pathplan
+{
+
+FreeConfigurationReservoir::FreeConfigurationReservoir(const unsigned int& dof, const unsigned int& capacity)
+{
+  if(dof<1 || capacity<1)
+    throw std::invalid_argument("free configuration reservoir dof and capacity must be at least 1");
+
+  dof_ = dof;
+  capacity_ = capacity;
+  size_ = 0;
+
+  configurations_.resize(dof_,capacity_);
+  versions_.resize(capacity_,0);
+  footprints_.resize(capacity_);
+  footprint_ = nullptr;
+
+  gen_.seed(std::random_device()());
+}
+
+void FreeConfigurationReservoir::add(const Eigen::VectorXd& configuration, const unsigned long& world_version)
+{
+  assert(configuration.size() == dof_);
+
+  std::function<Eigen::AlignedBox3d(const Eigen::VectorXd&)> footprint;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    footprint = footprint_;
+  }
+
+  Eigen::AlignedBox3d box; //empty without footprint, the configuration is always checked again
+  if(footprint)
+    box = footprint(configuration); //forward kinematics outside the lock
+
+  std::lock_guard<std::mutex> lock(mtx_);
+
+  unsigned int slot;
+  if(size_<capacity_)
+    slot = size_++;
+  else
+    slot = std::uniform_int_distribution<unsigned int>(0,capacity_-1)(gen_);
+
+  configurations_.col(slot) = configuration;
+  versions_[slot] = world_version;
+  footprints_[slot] = box;
+}
+
+void FreeConfigurationReservoir::addWorldChange(const unsigned long& world_version, const std::vector<Eigen::AlignedBox3d>& boxes)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+
+  WorldChange change;
+  change.version = world_version;
+  change.boxes = boxes;
+  world_changes_.push_back(change);
+
+  if(world_changes_.size()>FREE_RESERVOIR_MAX_WORLD_CHANGES)
+    world_changes_.pop_front();
+}
+
+bool FreeConfigurationReservoir::changedNear(const Eigen::AlignedBox3d& footprint, const unsigned long& from, const unsigned long& to) const
+{
+  /* Every change between from and to must be known: versions are consecutive and the log is ordered */
+  if(footprint.isEmpty() || from>to || world_changes_.empty() ||
+     world_changes_.front().version>from+1 || world_changes_.back().version<to)
+    return true;
+
+  for(const WorldChange& change:world_changes_)
+  {
+    if(change.version<=from || change.version>to)
+      continue;
+
+    for(const Eigen::AlignedBox3d& box:change.boxes)
+    {
+      if(box.intersects(footprint))
+        return true;
+    }
+  }
+
+  return false;
+}
+
+bool FreeConfigurationReservoir::draw(const std::function<bool(const Eigen::VectorXd&)>& accept,
+                                      const CollisionCheckerPtr& checker,
+                                      const unsigned long& world_version,
+                                      Eigen::VectorXd& configuration)
+{
+  unsigned int slot;
+  unsigned long version;
+
+  for(unsigned int t=0;t<FREE_RESERVOIR_TRIES;t++)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if(size_ == 0)
+        return false;
+
+      slot = std::uniform_int_distribution<unsigned int>(0,size_-1)(gen_);
+      configuration = configurations_.col(slot);
+      version = versions_[slot];
+    }
+
+    if(not accept(configuration))
+      continue;
+
+    if(version == world_version)
+      return true;
+
+    //validated in a different world, check it again unless no object changed near it
+    bool near;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      near = (slot>=size_ || configurations_.col(slot) != configuration || changedNear(footprints_[slot],version,world_version));
+    }
+
+    bool free = (not near) || checker->check(configuration);
+
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if(slot<size_ && versions_[slot] == version && configurations_.col(slot) == configuration) //not replaced or moved in the meantime
+      {
+        if(free)
+          versions_[slot] = world_version;
+        else
+        {
+          size_--;
+          configurations_.col(slot) = configurations_.col(size_);
+          versions_[slot] = versions_[size_];
+        }
+      }
+    }
+
+    if(free)
+      return true;
+  }
+
+  return false;
+}
+
+FreeReservoirSampler::FreeReservoirSampler(const Eigen::VectorXd& start_configuration,
+                                           const Eigen::VectorXd& stop_configuration,
+                                           const Eigen::VectorXd& lower_bound,
+                                           const Eigen::VectorXd& upper_bound,
+                                           const InformedSamplerPtr& sampler,
+                                           const FreeConfigurationReservoirPtr& reservoir,
+                                           const CollisionCheckerPtr& checker,
+                                           const unsigned long& world_version,
+                                           const double& bias,
+                                           const double& cost):
+  InformedSampler(start_configuration,stop_configuration,lower_bound,upper_bound,cost)
+{
+  sampler_ = sampler;
+  reservoir_ = reservoir;
+  checker_ = checker;
+  world_version_ = world_version;
+  bias_ = bias;
+
+  focus1_ = start_configuration;
+  focus2_ = stop_configuration;
+  lb_ = lower_bound;
+  ub_ = upper_bound;
+  cost_bound_ = cost;
+
+  gen_.seed(std::random_device()());
+  ud_ = std::uniform_real_distribution<double>(0.0,1.0);
+}
+
+void FreeReservoirSampler::setCost(const double& cost)
+{
+  InformedSampler::setCost(cost);
+  sampler_->setCost(cost);
+  cost_bound_ = cost;
+}
+
+Eigen::VectorXd FreeReservoirSampler::sample()
+{
+  if(ud_(gen_)<bias_)
+  {
+    Eigen::VectorXd q;
+    auto in_informed_set = [&](const Eigen::VectorXd& c) -> bool
+    {
+      if(((c-lb_).array()<0.0).any() || ((c-ub_).array()>0.0).any())
+        return false;
+
+      return ((c-focus1_).norm()+(c-focus2_).norm())<=cost_bound_;
+    };
+
+    if(reservoir_->draw(in_informed_set,checker_,world_version_,q))
+      return q;
+  }
+
+  return sampler_->sample();
+}
+
+}
@@ -0,0 +1,163 @@
+#include "replanners_lib/kinematic_chain.h"
+
+namespace pathplan
+{
+
+KinematicChain::KinematicChain(const planning_scene::PlanningSceneConstPtr &planning_scene,
+                               const std::string &group_name,
+                               const std::string &tip_link)
+{
+  const moveit::core::RobotModelConstPtr& model = planning_scene->getRobotModel();
+  const moveit::core::JointModelGroup* group = model->getJointModelGroup(group_name);
+  if(not group)
+    throw std::invalid_argument("group "+group_name+" not found");
+
+  const moveit::core::LinkModel* tip = model->getLinkModel(tip_link);
+  if(not tip)
+    throw std::invalid_argument("link "+tip_link+" not found");
+
+  tip_link_ = tip_link;
+  dof_ = group->getVariableCount();
+
+  moveit::core::RobotState state = planning_scene->getCurrentState();
+  state.updateLinkTransforms();
+
+  auto isActuated = [&](const moveit::core::JointModel* joint)->bool{
+    return (group->hasJointModel(joint->getName()) && joint->getMimic() == nullptr &&
+            (joint->getType() == moveit::core::JointModel::REVOLUTE || joint->getType() == moveit::core::JointModel::PRISMATIC));
+  };
+
+  /* Links from the tip up to the child link of the first actuated joint */
+  std::vector<const moveit::core::LinkModel*> links;
+  const moveit::core::LinkModel* link = tip;
+  int first_actuated = -1;
+  while(link)
+  {
+    links.push_back(link);
+
+    const moveit::core::JointModel* joint = link->getParentJointModel();
+    if(not joint)
+      break;
+
+    if(isActuated(joint))
+      first_actuated = links.size()-1;
+
+    link = joint->getParentLinkModel();
+  }
+
+  if(first_actuated<0)
+    throw std::invalid_argument("no joint of group "+group_name+" moves link "+tip_link);
+
+  links.resize(first_actuated+1);
+  std::reverse(links.begin(),links.end());
+
+  const moveit::core::LinkModel* base_link = links.front()->getParentJointModel()->getParentLinkModel();
+  if(base_link)
+    base_ = state.getGlobalLinkTransform(base_link);
+  else
+    base_.setIdentity();
+
+  Eigen::Isometry3d fixed = Eigen::Isometry3d::Identity();
+  Eigen::Isometry3d joint_transform;
+  for(const moveit::core::LinkModel* l:links)
+  {
+    fixed = fixed*l->getJointOriginTransform();
+
+    const moveit::core::JointModel* joint = l->getParentJointModel();
+    if(isActuated(joint))
+    {
+      Joint j;
+      j.origin = fixed;
+      j.index = group->getVariableGroupIndex(joint->getName());
+      j.revolute = (joint->getType() == moveit::core::JointModel::REVOLUTE);
+
+      if(j.revolute)
+        j.axis = static_cast<const moveit::core::RevoluteJointModel*>(joint)->getAxis();
+      else
+        j.axis = static_cast<const moveit::core::PrismaticJointModel*>(joint)->getAxis();
+
+      joints_.push_back(j);
+      fixed.setIdentity();
+    }
+    else
+    {
+      joint->computeTransform(state.getJointPositions(joint),joint_transform);
+      fixed = fixed*joint_transform;
+    }
+  }
+
+  tip_ = fixed;
+}
+
+Eigen::Isometry3d KinematicChain::transform(const Eigen::VectorXd& conf) const
+{
+  assert(conf.size() == dof_);
+
+  Eigen::Isometry3d t = base_;
+  for(const Joint& j:joints_)
+  {
+    t = t*j.origin;
+
+    if(j.revolute)
+      t.rotate(Eigen::AngleAxisd(conf[j.index],j.axis));
+    else
+      t.translate(conf[j.index]*j.axis);
+  }
+
+  return t*tip_;
+}
+
+Eigen::Vector3d KinematicChain::position(const Eigen::VectorXd& conf) const
+{
+  return transform(conf).translation();
+}
+
+GroupFootprint::GroupFootprint(const planning_scene::PlanningSceneConstPtr &planning_scene,
+                               const std::string &group_name)
+{
+  const moveit::core::RobotModelConstPtr& model = planning_scene->getRobotModel();
+  if(not model->getJointModelGroup(group_name))
+    throw std::invalid_argument("group "+group_name+" not found");
+
+  moveit::core::RobotState state = planning_scene->getCurrentState();
+  state.updateLinkTransforms();
+
+  double radius;
+  for(const moveit::core::LinkModel* link:model->getLinkModelsWithCollisionGeometry())
+  {
+    radius = link->getCenteredBoundingBoxOffset().norm()+0.5*link->getShapeExtentsAtOrigin().norm();
+
+    KinematicChainPtr chain;
+    try
+    {
+      chain = std::make_shared<KinematicChain>(planning_scene,group_name,link->getName());
+    }
+    catch(const std::invalid_argument&) //not moved by the group
+    {
+      Eigen::Vector3d origin = state.getGlobalLinkTransform(link).translation();
+      fixed_box_.extend(origin-Eigen::Vector3d::Constant(radius));
+      fixed_box_.extend(origin+Eigen::Vector3d::Constant(radius));
+      continue;
+    }
+
+    chains_.push_back(chain);
+    radii_.push_back(radius);
+  }
+}
+
+Eigen::AlignedBox3d GroupFootprint::box(const Eigen::VectorXd& conf) const
+{
+  Eigen::AlignedBox3d box = fixed_box_;
+
+  Eigen::Vector3d origin;
+  for(unsigned int i=0;i<chains_.size();i++)
+  {
+    origin = chains_[i]->position(conf);
+    box.extend(origin-Eigen::Vector3d::Constant(radii_[i]));
+    box.extend(origin+Eigen::Vector3d::Constant(radii_[i]));
+  }
+
+  return box;
+}
+
+}
@@ -11,15 +11,41 @@ MoveitUtils::MoveitUtils(const planning_scene::PlanningScenePtr &planning_scene,
   group_name_ = group_name;
 }
 
+moveit::core::RobotState& MoveitUtils::scratchState() const
+{
+  static thread_local robot_state::RobotStatePtr state;
+  if(not state || state->getRobotModel() != kinematic_model_)
+    state = std::make_shared<moveit::core::RobotState>(planning_scene_->getCurrentState());
+
+  return *state;
+}
+
 std::vector<moveit::core::RobotState> MoveitUtils::fromWaypoints2State(const std::vector<Eigen::VectorXd> waypoints) const
 {
   std::vector<moveit::core::RobotState> wp_state_vector;
-  for(const Eigen::VectorXd& waypoint: waypoints)
+  fromWaypoints2State(waypoints,wp_state_vector);
+
+  return wp_state_vector;
+}
+
+void MoveitUtils::fromWaypoints2State(const std::vector<Eigen::VectorXd>& waypoints, std::vector<moveit::core::RobotState>& wp_state_vector) const
+{
+  if(wp_state_vector.size()>waypoints.size())
+    wp_state_vector.erase(wp_state_vector.begin()+waypoints.size(),wp_state_vector.end());
+  else if(wp_state_vector.size()<waypoints.size())
   {
-    moveit::core::RobotState wp_state=fromWaypoints2State(waypoint);
-    wp_state_vector.push_back(wp_state);
+    wp_state_vector.reserve(waypoints.size());
+
+    const moveit::core::RobotState& current_state = planning_scene_->getCurrentState();
+    while(wp_state_vector.size()<waypoints.size())
+      wp_state_vector.push_back(current_state);
+  }
+
+  for(unsigned int i=0;i<waypoints.size();i++)
+  {
+    wp_state_vector[i].setJointGroupPositions(group_name_,waypoints[i]);
+    wp_state_vector[i].update();
   }
-  return wp_state_vector;
 }
 
 moveit::core::RobotState MoveitUtils::fromWaypoints2State(const Eigen::VectorXd& waypoint) const
@@ -31,4 +57,25 @@ moveit::core::RobotState MoveitUtils::fromWaypoints2State(const Eigen::VectorXd&
   return wp_state;
 }
 
+Eigen::Isometry3d MoveitUtils::forwardKinematics(const Eigen::VectorXd& waypoint, const std::string& link) const
+{
+  return forwardKinematics(waypoint,link,scratchState());
+}
+
+Eigen::Isometry3d MoveitUtils::forwardKinematics(const Eigen::VectorXd& waypoint, const std::string& link, moveit::core::RobotState& state) const
+{
+  const moveit::core::LinkModel* link_model = kinematic_model_->getLinkModel(link);
+  if(link_model == nullptr)
+    throw std::invalid_argument("link "+link+" not found");
+
+  state.setJointGroupPositions(group_name_,waypoint);
+
+  //Only the joints between the root and link are evaluated, the other link transforms are left dirty
+  Eigen::Isometry3d transform = Eigen::Isometry3d::Identity();
+  for(const moveit::core::LinkModel* l=link_model;l!=nullptr;l=l->getParentLinkModel())
+    transform = l->getJointOriginTransform()*state.getJointTransform(l->getParentJointModel())*transform;
+
+  return transform;
+}
+
 }
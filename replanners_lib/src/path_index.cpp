@@ -0,0 +1,253 @@
+#include "replanners_lib/path_index.h"
+
+namespace pathplan
+{
+
+PathIndex::PathIndex(const PathPtr &path)
+{
+  const std::vector<ConnectionPtr>& conns = path->getConnectionsConst();
+  if(conns.empty())
+    throw std::invalid_argument("path with no connections");
+
+  unsigned int n_conns = conns.size();
+  unsigned int dof = conns.front()->getParent()->getConfiguration().size();
+
+  waypoints_.resize(n_conns+1,dof);
+  prefix_length_.resize(n_conns+1);
+  conn_cost_.resize(n_conns);
+
+  waypoints_.row(0) = conns.front()->getParent()->getConfiguration().transpose();
+  for(unsigned int i=0;i<n_conns;i++)
+  {
+    waypoints_.row(i+1) = conns[i]->getChild()->getConfiguration().transpose();
+    conn_cost_[i] = conns[i]->getCost();
+  }
+
+  segments_ = waypoints_.bottomRows(n_conns)-waypoints_.topRows(n_conns);
+  segment_sq_length_ = segments_.rowwise().squaredNorm().array();
+  segment_length_ = segment_sq_length_.sqrt();
+
+  prefix_length_[0] = 0.0;
+  for(unsigned int i=0;i<n_conns;i++)
+    prefix_length_[i+1] = prefix_length_[i]+segment_length_(i);
+
+  updateSuffixCost(); //const queries never modify an index whose costs are not changed
+
+  switch(dof)
+  {
+  case 3:  selectKernels<3> (); break;
+  case 6:  selectKernels<6> (); break;
+  case 12: selectKernels<12>(); break;
+  case 18: selectKernels<18>(); break;
+  default: selectKernels<Eigen::Dynamic>();
+  }
+}
+
+template<int DOF>
+void PathIndex::selectKernels()
+{
+  is_on_connection_   = &PathIndex::isOnConnectionKernel<DOF>;
+  find_connection_    = &PathIndex::findConnectionKernel<DOF>;
+  nearest_connection_ = &PathIndex::nearestConnectionKernel<DOF>;
+}
+
+template<int DOF>
+bool PathIndex::isOnConnectionKernel(const Eigen::VectorXd& conf, const unsigned int& idx) const
+{
+  typedef Eigen::Matrix<double,1,DOF> Row;
+
+  Row q = conf.transpose();
+  double conn_length = prefix_length_[idx+1]-prefix_length_[idx];
+  return (((q-waypoints_.row(idx)).norm()+(waypoints_.row(idx+1)-q).norm()-conn_length)<TOLERANCE);
+}
+
+template<int DOF>
+int PathIndex::findConnectionKernel(const Eigen::VectorXd& conf, const int& hint) const
+{
+  typedef Eigen::Array<double,PATH_INDEX_BLOCK+1,1> Block;
+
+  int n_conns = conn_cost_.size();
+
+  /* The configurations queried move forward along the path, so look at the hint and at the following connection first */
+  if(hint>=0 && hint<n_conns)
+  {
+    for(int i=hint;i<std::min(hint+2,n_conns);i++)
+    {
+      if(isOnConnectionKernel<DOF>(conf,i))
+        return i;
+    }
+  }
+
+  /* Otherwise, test all the connections: distances from the waypoints, then the triangle inequality on each connection.
+   * The connections are processed in blocks of PATH_INDEX_BLOCK on fixed-size arrays (no allocation), forward from the
+   * hint and then backward */
+  int dof = (DOF == Eigen::Dynamic)? waypoints_.cols():DOF;
+  Block wp_distance, excess;
+
+  auto blockExcess = [&](const int& first, const int& n) //connections [first,first+n), waypoints [first,first+n]
+  {
+    wp_distance.head(n+1).setZero();
+    for(int d=0;d<dof;d++)
+      wp_distance.head(n+1) += (waypoints_.col(d).segment(first,n+1).array()-conf(d)).square();
+
+    wp_distance.head(n+1) = wp_distance.head(n+1).sqrt();
+    excess.head(n) = wp_distance.head(n)+wp_distance.segment(1,n)-segment_length_.segment(first,n);
+  };
+
+  int start = (hint>=0 && hint<n_conns)? hint:0;
+  for(int first=start;first<n_conns;first+=PATH_INDEX_BLOCK)
+  {
+    int n = std::min(PATH_INDEX_BLOCK,n_conns-first);
+    blockExcess(first,n);
+
+    for(int i=0;i<n;i++)
+    {
+      if(excess(i)<TOLERANCE)
+        return first+i;
+    }
+  }
+  for(int last=start-1;last>=0;last-=PATH_INDEX_BLOCK)
+  {
+    int n = std::min(PATH_INDEX_BLOCK,last+1);
+    int first = last-n+1;
+    blockExcess(first,n);
+
+    for(int i=n-1;i>=0;i--)
+    {
+      if(excess(i)<TOLERANCE)
+        return first+i;
+    }
+  }
+
+  return -1;
+}
+
+template<int DOF>
+int PathIndex::nearestConnectionKernel(const Eigen::VectorXd& conf, Eigen::VectorXd& projection, double& distance,
+                                       const int& first, const int& last) const
+{
+  typedef Eigen::Array<double,PATH_INDEX_BLOCK,1> Block;
+
+  int n_conns = conn_cost_.size();
+  int from = std::max(0,std::min(first,n_conns-1));
+  int to   = (last<0 || last>=n_conns)? n_conns-1:std::max(last,from);
+  int dof = (DOF == Eigen::Dynamic)? waypoints_.cols():DOF;
+
+  /* For each connection a-b and point p: t = clamp((p-a)*(b-a)/|b-a|^2,0,1), |a+t(b-a)-p|^2 = |a-p|^2+2t(a-p)*(b-a)+t^2|b-a|^2.
+   * The connections are processed in blocks of PATH_INDEX_BLOCK, the sums over the joints are accumulated column by
+   * column, each column being contiguous over the connections of the block */
+  Block dot, sq, diff, len2, t, dist2;
+
+  int best = from;
+  double best_t = 0.0, best_dist2 = std::numeric_limits<double>::infinity();
+  for(int start=from;start<=to;start+=PATH_INDEX_BLOCK)
+  {
+    int n = std::min(PATH_INDEX_BLOCK,to-start+1);
+
+    dot.head(n).setZero();
+    sq .head(n).setZero();
+    for(int d=0;d<dof;d++)
+    {
+      diff.head(n) = waypoints_.col(d).segment(start,n).array()-conf(d);
+      dot .head(n) += diff.head(n)*segments_.col(d).segment(start,n).array();
+      sq  .head(n) += diff.head(n).square();
+    }
+
+    len2 .head(n) = segment_sq_length_.segment(start,n);
+    t    .head(n) = (len2.head(n)>0.0).select((-dot.head(n)/len2.head(n)).max(0.0).min(1.0),0.0);
+    dist2.head(n) = sq.head(n)+2.0*t.head(n)*dot.head(n)+t.head(n).square()*len2.head(n);
+
+    int idx;
+    double block_min = dist2.head(n).minCoeff(&idx);
+    if(block_min<best_dist2)
+    {
+      best_dist2 = block_min;
+      best_t = t(idx);
+      best = start+idx;
+    }
+  }
+
+  distance = std::sqrt(std::max(0.0,best_dist2));
+  projection = waypoints_.row(best).transpose()+best_t*segments_.row(best).transpose();
+
+  return best;
+}
+
+int PathIndex::locate(const Eigen::VectorXd& conf, const int& hint) const
+{
+  int idx = findConnection(conf,hint);
+  if(idx>=0)
+    return idx;
+
+  double distance;
+  Eigen::VectorXd projection;
+  return nearestConnection(conf,projection,distance);
+}
+
+double PathIndex::curvilinearAbscissaOfPoint(const Eigen::VectorXd& conf, int& idx, const int& hint) const
+{
+  idx = locate(conf,hint);
+
+  return (length()>0.0)? (prefix_length_[idx]+projectionRatio(conf,idx)*segment_length_(idx))/length():0.0;
+}
+
+void PathIndex::pointOnCurvilinearAbscissa(const double& abscissa, Eigen::VectorXd& point) const
+{
+  if(abscissa<=0.0)
+  {
+    point = waypoints_.row(0).transpose();
+    return;
+  }
+  if(abscissa>=1.0)
+  {
+    point = waypoints_.row(waypoints_.rows()-1).transpose();
+    return;
+  }
+
+  double target = abscissa*length();
+
+  unsigned int idx = std::upper_bound(prefix_length_.begin(),prefix_length_.end(),target)-prefix_length_.begin();
+  idx = std::max(1u,std::min(idx,(unsigned int)prefix_length_.size()-1))-1;
+
+  double conn_length = prefix_length_[idx+1]-prefix_length_[idx];
+  if(conn_length<=0.0)
+    point = waypoints_.row(idx).transpose();
+  else
+    point = (waypoints_.row(idx)+((target-prefix_length_[idx])/conn_length)*segments_.row(idx)).transpose();
+}
+
+void PathIndex::setConnectionCost(const unsigned int& idx, const double& cost)
+{
+  if(conn_cost_.at(idx) != cost)
+  {
+    conn_cost_[idx] = cost;
+    costs_changed_ = true;
+  }
+}
+
+void PathIndex::updateSuffixCost() const
+{
+  suffix_cost_.resize(conn_cost_.size()+1);
+  suffix_cost_.back() = 0.0;
+
+  for(int i=conn_cost_.size()-1;i>=0;i--)
+    suffix_cost_[i] = suffix_cost_[i+1]+conn_cost_[i];
+
+  costs_changed_ = false;
+}
+
+double PathIndex::getCostFromConf(const Eigen::VectorXd& conf, int& idx, const int& hint) const
+{
+  if(costs_changed_)
+    updateSuffixCost();
+
+  idx = locate(conf,hint);
+
+  if(conn_cost_[idx] == std::numeric_limits<double>::infinity())
+    return std::numeric_limits<double>::infinity();
+
+  double ratio = (segment_length_(idx)>0.0)? 1.0-projectionRatio(conf,idx):0.0;
+  return ratio*conn_cost_[idx]+suffix_cost_[idx+1];
+}
+
+}
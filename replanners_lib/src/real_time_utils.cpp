@@ -0,0 +1,134 @@
+#include "replanners_lib/real_time_utils.h"
+
+namespace pathplan
+{
+
+bool setRealTimePriority(const int& priority)
+{
+  sched_param param;
+  param.sched_priority = std::max(sched_get_priority_min(SCHED_FIFO),std::min(priority,sched_get_priority_max(SCHED_FIFO)));
+
+  int err = pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
+  if(err != 0)
+  {
+    ROS_ERROR("unable to set SCHED_FIFO priority %d: %s (check rtprio limits)",param.sched_priority,strerror(err));
+    return false;
+  }
+
+  return true;
+}
+
+bool lockMemory()
+{
+  if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+  {
+    ROS_ERROR("unable to lock memory: %s (check memlock limits)",strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+void addNanoseconds(timespec& t, const long& ns)
+{
+  t.tv_nsec += ns;
+  while(t.tv_nsec>=1000000000L)
+  {
+    t.tv_nsec -= 1000000000L;
+    t.tv_sec++;
+  }
+}
+
+double timespecDiff(const timespec& t1, const timespec& t0)
+{
+  return (t1.tv_sec-t0.tv_sec)+(t1.tv_nsec-t0.tv_nsec)*1.0e-09;
+}
+
+bool setThreadAffinity(const pthread_t& thread, const std::vector<int>& cpus)
+{
+  if(cpus.empty())
+    return true;
+
+  int n_cpus = std::thread::hardware_concurrency();
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for(const int& cpu:cpus)
+  {
+    if(cpu<0 || cpu>=n_cpus)
+    {
+      ROS_ERROR("cpu %d not available (%d cpus)",cpu,n_cpus);
+      return false;
+    }
+    CPU_SET(cpu,&cpu_set);
+  }
+
+  int err = pthread_setaffinity_np(thread,sizeof(cpu_set_t),&cpu_set);
+  if(err != 0)
+  {
+    ROS_ERROR("unable to set thread affinity: %s",strerror(err));
+    return false;
+  }
+
+  return true;
+}
+
+LoopTimingStatistics::LoopTimingStatistics(const unsigned int& n_bins, const double& bin_width)
+{
+  assert(n_bins>0 && bin_width>0.0);
+
+  bin_width_ = bin_width;
+  histogram_.resize(n_bins,0.0);
+
+  msg_.layout.dim.resize(2);
+  msg_.layout.dim[0].label  = "statistics";
+  msg_.layout.dim[0].size   = 5;
+  msg_.layout.dim[0].stride = 5;
+  msg_.layout.dim[1].label  = "jitter_histogram";
+  msg_.layout.dim[1].size   = n_bins;
+  msg_.layout.dim[1].stride = n_bins;
+  msg_.data.resize(5+n_bins,0.0);
+
+  reset();
+}
+
+void LoopTimingStatistics::addCycle(const double& jitter, const double& duration, const bool& overrun)
+{
+  cycles_++;
+  if(overrun)
+    overruns_++;
+
+  double jitter_us = std::abs(jitter)*1.0e06;
+  sum_jitter_ += jitter_us;
+  max_jitter_ = std::max(max_jitter_,jitter_us);
+  max_duration_ = std::max(max_duration_,duration*1.0e06);
+
+  unsigned int bin = std::min<unsigned int>(jitter_us/bin_width_,histogram_.size()-1);
+  histogram_[bin] += 1.0;
+}
+
+const std_msgs::Float64MultiArray& LoopTimingStatistics::toMsg()
+{
+  msg_.data[0] = cycles_;
+  msg_.data[1] = overruns_;
+  msg_.data[2] = (cycles_>0)? sum_jitter_/cycles_ : 0.0;
+  msg_.data[3] = max_jitter_;
+  msg_.data[4] = max_duration_;
+
+  std::copy(histogram_.begin(),histogram_.end(),msg_.data.begin()+5);
+
+  return msg_;
+}
+
+void LoopTimingStatistics::reset()
+{
+  cycles_       = 0  ;
+  overruns_     = 0  ;
+  max_jitter_   = 0.0;
+  sum_jitter_   = 0.0;
+  max_duration_ = 0.0;
+
+  std::fill(histogram_.begin(),histogram_.end(),0.0);
+}
+
+}
@@ -11,6 +11,50 @@ ReplannerManagerDRRT::ReplannerManagerDRRT(const PathPtr &current_path,
   tmp_solver->importFromSolver(solver);
 
   solver_  = tmp_solver;
+
+  DRRTadditionalParams();
+}
+
+void ReplannerManagerDRRT::DRRTadditionalParams()
+{
+  if(!nh_.getParam("DRRT/regrow_batch_size",regrow_batch_size_))
+  {
+    ROS_ERROR("DRRT/regrow_batch_size not set, set 1");
+    regrow_batch_size_ = 1;
+  }
+  else
+  {
+    if(regrow_batch_size_<1)
+    {
+      ROS_ERROR("DRRT/regrow_batch_size can not be less than 1, set 1");
+      regrow_batch_size_ = 1;
+    }
+  }
+
+  if(!nh_.getParam("DRRT/orphan_bias",orphan_bias_))
+  {
+    ROS_ERROR("DRRT/orphan_bias not set, set 0.0");
+    orphan_bias_ = 0.0;
+  }
+  else
+  {
+    if(orphan_bias_<0.0 || orphan_bias_>1.0)
+    {
+      ROS_ERROR("DRRT/orphan_bias must be in [0,1], set 0.0");
+      orphan_bias_ = 0.0;
+    }
+  }
+}
+
+void ReplannerManagerDRRT::splitCoreBudget()
+{
+  ReplannerManagerBase::splitCoreBudget();
+
+  if(core_budget_>0 && regrow_batch_size_>1) //each parallel validation of the batch regrow clones the replanning checker
+  {
+    n_replanning_checkers_ = regrow_batch_size_;
+    checker_replanning_n_threads_ = std::max(1,checker_replanning_n_threads_/regrow_batch_size_);
+  }
 }
 
 void ReplannerManagerDRRT::startReplannedPathFromNewCurrentConf(const Eigen::VectorXd& configuration)
@@ -80,7 +124,7 @@ void ReplannerManagerDRRT::startReplannedPathFromNewCurrentConf(const Eigen::Vec
     ConnectionPtr conn2delete = new_tree_branch_connections.at(0);
     NodePtr child = conn2delete->getChild();
 
-    ConnectionPtr new_conn = std::make_shared<Connection>(replanned_path_start,child);
+    ConnectionPtr new_conn = makeConnection(replanned_path_start,child);
     new_conn->setCost(conn2delete->getCost());
     new_conn->add();
 
@@ -110,10 +154,10 @@ void ReplannerManagerDRRT::startReplannedPathFromNewCurrentConf(const Eigen::Vec
     ConnectionPtr conn_on_replannned_path = replanned_path->findConnection(configuration,idx_current_conf_on_replanned);
     if(conn_on_replannned_path)
     {
-      current_node = std::make_shared<Node>(configuration);
+      current_node = makeNode(configuration);
 
       NodePtr child = replanned_path->getConnections().at(idx_current_conf_on_replanned)->getChild();
-      conn = std::make_shared<Connection>(child,current_node);
+      conn = makeConnection(child,current_node);
 
       MetricsPtr metrics = solver_->getMetrics();
       if(replanned_path->getConnections().at(idx_current_conf_on_replanned)->getCost() == std::numeric_limits<double>::infinity())
@@ -187,7 +231,7 @@ void ReplannerManagerDRRT::startReplannedPathFromNewCurrentConf(const Eigen::Vec
         NodePtr parent = replanned_path->getConnections().at(idx)->getChild();
         NodePtr child = conn2delete->getChild();
 
-        new_conn = std::make_shared<Connection>(parent,child);
+        new_conn = makeConnection(parent,child);
         new_conn->setCost(conn2delete->getCost());
         new_conn->add();
 
@@ -198,7 +242,7 @@ void ReplannerManagerDRRT::startReplannedPathFromNewCurrentConf(const Eigen::Vec
         ConnectionPtr conn2delete = new_tree_branch_connections.at(0);
         NodePtr child = conn2delete->getChild();
 
-        new_conn = std::make_shared<Connection>(replanned_path_start,child);
+        new_conn = makeConnection(replanned_path_start,child);
         new_conn->setCost(conn2delete->getCost());
         new_conn->add();
 
@@ -232,7 +276,11 @@ bool ReplannerManagerDRRT::haveToReplan(const bool path_obstructed)
 void ReplannerManagerDRRT::initReplanner()
 {
   double time_for_repl = 0.9*dt_replan_;
-  replanner_ = std::make_shared<pathplan::DynamicRRT>(configuration_replan_, current_path_, time_for_repl, solver_);
+  DynamicRRTPtr replanner = std::make_shared<pathplan::DynamicRRT>(configuration_replan_, current_path_, time_for_repl, solver_);
+  replanner->setRegrowBatchSize(regrow_batch_size_);
+  replanner->setOrphanBias(orphan_bias_);
+
+  replanner_ = replanner;
 }
 
 }
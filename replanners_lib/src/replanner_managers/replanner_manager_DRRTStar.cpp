@@ -10,6 +10,36 @@ ReplannerManagerDRRTStar::ReplannerManagerDRRTStar(const PathPtr &current_path,
   tmp_solver->importFromSolver(solver);
 
   solver_  = tmp_solver;
+
+  DRRTStarAdditionalParams();
+}
+
+void ReplannerManagerDRRTStar::DRRTStarAdditionalParams()
+{
+  if(!nh_.getParam("DRRTStar/rewire_n_threads",rewire_n_threads_))
+  {
+    ROS_ERROR("DRRTStar/rewire_n_threads not set, set 1");
+    rewire_n_threads_ = 1;
+  }
+  else
+  {
+    if(rewire_n_threads_<1)
+    {
+      ROS_ERROR("DRRTStar/rewire_n_threads can not be less than 1, set 1");
+      rewire_n_threads_ = 1;
+    }
+  }
+}
+
+void ReplannerManagerDRRTStar::splitCoreBudget()
+{
+  ReplannerManagerBase::splitCoreBudget();
+
+  if(core_budget_>0 && rewire_n_threads_>1) //each rewire thread clones the replanning checker
+  {
+    n_replanning_checkers_ = rewire_n_threads_;
+    checker_replanning_n_threads_ = std::max(1,checker_replanning_n_threads_/rewire_n_threads_);
+  }
 }
 
 void ReplannerManagerDRRTStar::startReplannedPathFromNewCurrentConf(const Eigen::VectorXd& configuration)
@@ -37,7 +67,7 @@ void ReplannerManagerDRRTStar::startReplannedPathFromNewCurrentConf(const Eigen:
     assert(conn->getParent() != nullptr && conn->getParent() != nullptr);
 
     current_node = current_path->addNodeAtCurrentConfig(configuration,conn,false);
-    conn = std::make_shared<Connection>(conn->getParent(),current_node);
+    conn = makeConnection(conn->getParent(),current_node);
     conn->setCost(tree->getMetrics()->cost(conn->getParent(),current_node));
     conn->add();
 
@@ -63,7 +93,7 @@ void ReplannerManagerDRRTStar::startReplannedPathFromNewCurrentConf(const Eigen:
 
           double restored_cost = parent_conn->getCost()+child_conn->getCost();
 
-          ConnectionPtr restored_conn = std::make_shared<Connection>(parent,child);
+          ConnectionPtr restored_conn = makeConnection(parent,child);
           restored_conn->setCost(restored_cost);
           restored_conn->add();
 
@@ -87,7 +117,10 @@ bool ReplannerManagerDRRTStar::haveToReplan(const bool path_obstructed)
 void ReplannerManagerDRRTStar::initReplanner()
 {
   double time_for_repl = 0.9*dt_replan_;
-  replanner_ = std::make_shared<pathplan::DynamicRRTStar>(configuration_replan_, current_path_, time_for_repl, solver_);
+  DynamicRRTStarPtr replanner = std::make_shared<pathplan::DynamicRRTStar>(configuration_replan_, current_path_, time_for_repl, solver_);
+  replanner->setRewireThreads(rewire_n_threads_);
+
+  replanner_ = replanner;
 }
 
 }
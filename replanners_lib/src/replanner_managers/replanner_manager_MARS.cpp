@@ -93,6 +93,9 @@ void ReplannerManagerMARS::attributeInitialization()
 
   other_paths_shared_.clear();
   other_paths_sync_needed_.clear();
+  other_paths_version_.clear();
+  other_paths_conns_.clear();
+  other_paths_snapshot_.clear();
   for(const PathPtr& p:other_paths_)
   {
     PathPtr other_path = p->clone();
@@ -102,6 +105,9 @@ void ReplannerManagerMARS::attributeInitialization()
     p->setChecker(checker_replanning_);
 
     other_paths_sync_needed_.push_back(false);
+    other_paths_version_.push_back(0);
+    other_paths_conns_.push_back(p->getConnections());
+    other_paths_snapshot_.push_back(std::make_shared<const PathSnapshot>(other_path,0));
   }
 
   time_shift_ = (dt_replan_relaxed_-dt_)*K_OFFSET;
@@ -117,14 +123,16 @@ void ReplannerManagerMARS::attributeInitialization()
   for(unsigned int i=0; i<pnt_replan_.positions.size();i++)
     point2project(i) = pnt_replan_.positions.at(i);
 
-  configuration_replan_ = current_path_shared_->projectOnPath(point2project);
+  int conn_idx;
+  configuration_replan_ = current_path_snapshot_->getIndex()->projectOnPath(point2project,conn_idx);
 }
 
 bool ReplannerManagerMARS::replan()
 {
+  double time_scale = (fallback_level_>0)? fallback_time_scale_:1.0;
   double cost = replanner_->getCurrentPath()->getCostFromConf(replanner_->getCurrentConf());
-  (cost == std::numeric_limits<double>::infinity())? (replanner_->setMaxTime(0.9*dt_replan_)):
-                                                     (replanner_->setMaxTime(0.9*dt_replan_relaxed_));
+  (cost == std::numeric_limits<double>::infinity())? (replanner_->setMaxTime(time_scale*0.9*dt_replan_)):
+                                                     (replanner_->setMaxTime(time_scale*0.9*dt_replan_relaxed_));
   bool path_changed = replanner_->replan();
 
   //CHANGE WITH PATH_CHANGED?
@@ -139,6 +147,8 @@ bool ReplannerManagerMARS::replan()
 
     other_paths_shared_.push_back(another_path);
     other_paths_sync_needed_.push_back(false);
+    other_paths_version_.push_back(0);
+    other_paths_snapshot_.push_back(std::make_shared<const PathSnapshot>(another_path,0));
 
     MARSPtr replanner = std::static_pointer_cast<MARS>(replanner_);
     replanner->addOtherPath(initial_path_,false); //replanner->getCurrentPath() can be slightly different (some new nodes)
@@ -146,6 +156,7 @@ bool ReplannerManagerMARS::replan()
     assert(another_path->getConnectionsSize() == initial_path_->getConnectionsSize());
 
     other_paths_.push_back(initial_path_); //not move from here
+    other_paths_conns_.push_back(initial_path_->getConnections());
 
     other_paths_mtx_.unlock();
   }
@@ -163,7 +174,7 @@ void ReplannerManagerMARS::startReplannedPathFromNewCurrentConf(const Eigen::Vec
 
   TreePtr tree = current_path->getTree();
 
-  assert(current_path->findConnection(configuration) != nullptr);
+  assert(PathIndex(current_path).findConnection(configuration)>=0);
 
   if(old_current_node_ && ((old_current_node_->getConfiguration()-configuration).norm()>TOLERANCE) && old_current_node_ != node_replan && tree->isInTree(old_current_node_))
   {
@@ -228,10 +239,10 @@ void ReplannerManagerMARS::startReplannedPathFromNewCurrentConf(const Eigen::Vec
     }
   }
 
-  int conn_idx;
   bool is_a_new_node;
   PathPtr tmp_p = current_path->clone();
-  ConnectionPtr conn = current_path->findConnection(configuration,conn_idx);
+  int conn_idx = PathIndex(current_path).findConnection(configuration);
+  ConnectionPtr conn = (conn_idx>=0)? current_path->getConnectionsConst().at(conn_idx):nullptr;
   NodePtr current_node = current_path->addNodeAtCurrentConfig(configuration,conn,true,is_a_new_node);
 
   assert([&]() ->bool{
@@ -247,7 +258,7 @@ void ReplannerManagerMARS::startReplannedPathFromNewCurrentConf(const Eigen::Vec
              ROS_INFO_STREAM("curr p:"<<*current_path);
              ROS_INFO_STREAM("tmp p: "<<*tmp_p);
 
-             tmp_p->findConnection(configuration,conn_idx,true);
+             ROS_INFO_STREAM("conn idx on tmp p: "<<PathIndex(tmp_p).findConnection(configuration));
 
              return false;
            }
@@ -285,8 +296,8 @@ void ReplannerManagerMARS::startReplannedPathFromNewCurrentConf(const Eigen::Vec
     }
     else if(distance<0)
     {
-      int idx;
-      ConnectionPtr current_conn = replanned_path->findConnection(configuration,idx,true);
+      int idx = PathIndex(replanned_path).findConnection(configuration);
+      ConnectionPtr current_conn = (idx>=0)? replanned_path->getConnectionsConst().at(idx):nullptr;
       if(current_conn != nullptr) //current node is on replanned path
       {
         if(current_conn->getParent() == current_node || current_conn->getChild() == current_node)
@@ -354,7 +365,7 @@ void ReplannerManagerMARS::startReplannedPathFromNewCurrentConf(const Eigen::Vec
         ConnectionPtr first_conn = replanned_path_conns.front();
         NodePtr child = first_conn->getChild();
 
-        ConnectionPtr new_conn = std::make_shared<Connection>(current_node,child,first_conn->isNet());
+        ConnectionPtr new_conn = makeConnection(current_node,child,first_conn->isNet());
         (first_conn->getCost()<std::numeric_limits<double>::infinity())?
               new_conn->setCost(replanned_path->getMetrics()->cost(current_node->getConfiguration(),child->getConfiguration())):
               new_conn->setCost(std::numeric_limits<double>::infinity());
@@ -494,7 +505,13 @@ void ReplannerManagerMARS::updateSharedPath()
       CollisionCheckerPtr checker = other_paths_shared_.at(i)->getChecker();
       other_paths_shared_.at(i) = other_paths_.at(i)->clone();
       other_paths_shared_.at(i)->setChecker(checker);
+
+      other_paths_version_.at(i)++;
+      other_paths_conns_.at(i) = other_paths_.at(i)->getConnections();
+      other_paths_snapshot_.at(i) = std::make_shared<const PathSnapshot>(other_paths_shared_.at(i),other_paths_version_.at(i));
     }
+    else if(other_paths_.at(i)->getConnectionsConst() != other_paths_conns_.at(i)) //same geometry, but connections replaced by the replanner
+      other_paths_conns_.at(i) = other_paths_.at(i)->getConnections();
   }
   other_paths_mtx_.unlock();
 }
@@ -503,6 +520,31 @@ void ReplannerManagerMARS::downloadPathCost()
 {
   ReplannerManagerBase::downloadPathCost();
 
+  for(const PathPtr& p:other_paths_)
+    p->cost(); //update path cost
+}
+
+void ReplannerManagerMARS::applyCostDelta(const CostDelta& delta)
+{
+  if(delta.path_id == 0)
+    return ReplannerManagerBase::applyCostDelta(delta);
+
+  unsigned int i = delta.path_id-1;
+  if(i<other_paths_.size() && i<other_paths_version_.size() && delta.path_version == other_paths_version_[i] && delta.conn_id<other_paths_conns_[i].size())
+  {
+    const std::vector<ConnectionPtr>& conns = other_paths_[i]->getConnectionsConst();
+    if(delta.conn_id<conns.size() && conns[delta.conn_id] == other_paths_conns_[i][delta.conn_id]) //the connection is still in the path
+      conns[delta.conn_id]->setCost(delta.cost);
+  }
+
+  if(delta.world_version>cost_world_version_)
+    cost_world_version_ = delta.world_version;
+}
+
+void ReplannerManagerMARS::syncPathCost()
+{
+  ReplannerManagerBase::syncPathCost();
+
   other_paths_mtx_.lock();
 
   unsigned int other_paths_size = std::min(other_paths_.size(),other_paths_shared_.size());
@@ -526,8 +568,6 @@ void ReplannerManagerMARS::downloadPathCost()
       else
         break;
     }
-
-    other_paths_.at(i)->cost(); //update path cost
   }
   other_paths_mtx_.unlock();
 }
@@ -545,6 +585,16 @@ void ReplannerManagerMARS::initReplanner()
   replanner_->setDisp(disp);
 }
 
+void ReplannerManagerMARS::applyFallbackLevel(const int& level)
+{
+  ReplannerManagerBase::applyFallbackLevel(level);
+
+  replanner_mtx_.lock();
+  MARSPtr replanner = std::static_pointer_cast<MARS>(replanner_);
+  replanner->setFullNetSearch(full_net_search_ && level == 0);
+  replanner_mtx_.unlock();
+}
+
 bool ReplannerManagerMARS::checkPathTask(const PathPtr& path)
 {
   bool valid = path->isValid();
@@ -558,20 +608,32 @@ void ReplannerManagerMARS::collisionCheckThread()
   moveit_msgs::GetPlanningScene ps_srv;
   Eigen::VectorXd current_configuration_copy;
 
+  paths_mtx_.lock();
   PathPtr current_path_copy = current_path_shared_->clone();
   current_path_copy->setChecker(checker_cc_);
+  cc_path_version_ = current_path_version_;
+  cc_path_costs_ = connectionsCost(current_path_copy);
+  paths_mtx_.unlock();
 
   std::vector<PathPtr> other_paths_copy;
   std::vector<CollisionCheckerPtr> checkers;
-  for(const PathPtr& p:other_paths_shared_)
+
+  other_paths_mtx_.lock();
+  cc_other_paths_version_.clear();
+  cc_other_paths_costs_.clear();
+  for(unsigned int i=0;i<other_paths_shared_.size();i++)
   {
-    PathPtr path_copy = p->clone();
+    PathPtr path_copy = other_paths_shared_.at(i)->clone();
     CollisionCheckerPtr checker = checker_cc_->clone();
 
     checkers.push_back(checker);
     path_copy->setChecker(checker);
     other_paths_copy.push_back(path_copy);
+
+    cc_other_paths_version_.push_back(other_paths_version_.at(i));
+    cc_other_paths_costs_.push_back(connectionsCost(path_copy));
   }
+  other_paths_mtx_.unlock();
 
   int other_path_size = other_paths_copy.size();
 
@@ -595,12 +657,19 @@ void ReplannerManagerMARS::collisionCheckThread()
     }
 
     scene_mtx_.lock();
+    bool world_changed = (planning_scene_msg.world != ps_srv.response.scene.world);
+    if(world_changed)
+      world_version_++;
+
     planning_scene_msg.world = ps_srv.response.scene.world;
     planning_scene_msg.is_diff = true;
 
     checker_cc_->setPlanningSceneMsg(planning_scene_msg);
     for(const CollisionCheckerPtr& checker: checkers)
       checker->setPlanningSceneMsg(planning_scene_msg);
+
+    if(world_changed)
+      recordWorldChange(world_version_);
     scene_mtx_.unlock();
 
     /* Update paths if they have been changed */
@@ -613,6 +682,8 @@ void ReplannerManagerMARS::collisionCheckThread()
     {
       current_path_copy = current_path_shared_->clone();
       current_path_copy->setChecker(checker_cc_);
+      cc_path_version_ = current_path_version_;
+      cc_path_costs_ = connectionsCost(current_path_copy);
       current_path_sync_needed_ = false;
     }
 
@@ -628,6 +699,9 @@ void ReplannerManagerMARS::collisionCheckThread()
       path_copy->setChecker(checker);
       other_paths_copy.push_back(path_copy);
 
+      cc_other_paths_version_.push_back(other_paths_version_.back());
+      cc_other_paths_costs_.push_back(connectionsCost(path_copy));
+
       other_path_size = other_paths_copy.size();
     }
 
@@ -638,6 +712,9 @@ void ReplannerManagerMARS::collisionCheckThread()
         other_paths_copy.at(i) = other_paths_shared_.at(i)->clone();
         other_paths_copy.at(i)->setChecker(checkers.at(i));
         other_paths_sync_needed_.at(i) = false;
+
+        cc_other_paths_version_.at(i) = other_paths_version_.at(i);
+        cc_other_paths_costs_.at(i) = connectionsCost(other_paths_copy.at(i));
       }
     }
 
@@ -678,12 +755,15 @@ void ReplannerManagerMARS::collisionCheckThread()
     {
       planning_scene_msg_.world = ps_srv.response.scene.world;  //not diff,it contains all pln scn info but only world is updated
       planning_scene_diff_msg_ = planning_scene_msg;            //diff, contains only world
+      planning_scene_diff_world_version_ = world_version_;
 
       download_scene_info_ = true;      //dowloadPathCost can be called because the scene and path cost are referred now to the last path found
 
     }
     scene_mtx_.unlock();
 
+    notifySceneUpdate();
+
     double duration = (ros::WallTime::now()-tic).toSec();
 
     if(duration>(1.0/collision_checker_thread_frequency_) && display_timing_warning_)
@@ -701,43 +781,18 @@ bool ReplannerManagerMARS::uploadPathsCost(const PathPtr& current_path_updated_c
 
   paths_mtx_.lock();
   if(not current_path_sync_needed_)
-  {
-    std::vector<ConnectionPtr> current_path_conns      = current_path_shared_     ->getConnections();
-    std::vector<ConnectionPtr> current_path_copy_conns = current_path_updated_copy->getConnections();
-
-    for(unsigned int j=0;j<current_path_conns.size();j++)
-    {
-      assert((current_path_conns.at(j)->getParent()->getConfiguration() == current_path_copy_conns.at(j)->getParent()->getConfiguration()) &&
-             (current_path_conns.at(j)->getChild() ->getConfiguration() == current_path_copy_conns.at(j)->getChild() ->getConfiguration()));
-
-      current_path_conns.at(j)->setCost(current_path_copy_conns.at(j)->getCost());
-    }
-    current_path_shared_->cost();
-  }
+    uploadConnectionsCost(0,cc_path_version_,current_path_shared_,current_path_shared_index_,current_path_updated_copy,cc_path_costs_);
   else
     updated = false;
 
-  if(current_path_shared_->getCostFromConf(current_configuration_) == std::numeric_limits<double>::infinity() && (display_timing_warning_ || display_replanning_success_))
+  if(current_path_shared_index_->getCostFromConf(current_configuration_,cc_conn_hint_,cc_conn_hint_) == std::numeric_limits<double>::infinity() && (display_timing_warning_ || display_replanning_success_))
     ROS_BOLDMAGENTA_STREAM("Obstacle detected!");
 
   other_paths_mtx_.lock();
   for(unsigned int i=0;i<other_paths_updated_copy.size();i++)
   {
     if(not other_paths_sync_needed_.at(i))
-    {
-      std::vector<ConnectionPtr> path_conns      = other_paths_shared_     .at(i)->getConnections();
-      std::vector<ConnectionPtr> path_copy_conns = other_paths_updated_copy.at(i)->getConnections();
-
-      assert(path_conns.size() == path_copy_conns.size());
-      for(unsigned int j=0;j<path_conns.size();j++)
-      {
-        path_conns.at(j)->setCost(path_copy_conns.at(j)->getCost());
-
-        assert((path_conns.at(j)->getParent()->getConfiguration() == path_copy_conns.at(j)->getParent()->getConfiguration()) &&
-               (path_conns.at(j)->getChild() ->getConfiguration() == path_copy_conns.at(j)->getChild() ->getConfiguration()));
-      }
-      other_paths_shared_.at(i)->cost();
-    }
+      uploadConnectionsCost(i+1,cc_other_paths_version_.at(i),other_paths_shared_.at(i),nullptr,other_paths_updated_copy.at(i),cc_other_paths_costs_.at(i));
     else
       updated = false;
   }
@@ -758,7 +813,7 @@ void ReplannerManagerMARS::displayOtherPaths()
   disp->clearMarkers();
 
   int path_id,wp_id;
-  std::vector<PathPtr> other_paths;
+  std::vector<PathSnapshotPtr> other_paths;
   std::vector<double> marker_color = {1.0,0.5,0.3,1.0};
   std::vector<double> marker_scale = {0.01,0.01,0.01};
 
@@ -769,19 +824,16 @@ void ReplannerManagerMARS::displayOtherPaths()
 
   while((not stop_) && ros::ok())
   {
-    other_paths.clear();
-
     other_paths_mtx_.lock();
-    for(const PathPtr& p:other_paths_shared_)
-      other_paths.push_back(p->clone());
+    other_paths = other_paths_snapshot_;
     other_paths_mtx_.unlock();
 
     path_id = 20000;
     wp_id = 25000;
 
-    for(const PathPtr& p:other_paths)
+    for(const PathSnapshotPtr& p:other_paths)
     {
-      disp->displayPathAndWaypoints(p,path_id,wp_id,"pathplan",marker_color);
+      disp->displayPathAndWaypoints(p->getPath(),path_id,wp_id,"pathplan",marker_color);
 
       path_id +=1;
       wp_id +=1000;
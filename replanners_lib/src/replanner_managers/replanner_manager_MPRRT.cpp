@@ -30,87 +30,51 @@ void ReplannerManagerMPRRT::additionalParams()
       n_threads_replan_ = 1;
     }
   }
-}
 
-void ReplannerManagerMPRRT::startReplannedPathFromNewCurrentConf(const Eigen::VectorXd& configuration)
-{
-  std::vector<pathplan::ConnectionPtr> path_connections;
-  PathPtr replanned_path = replanner_->getReplannedPath();
-  Eigen::VectorXd replanned_path_start_conf = replanned_path->getStartNode()->getConfiguration();
-  std::vector<ConnectionPtr> conn_replanned = replanned_path->getConnections();
+  if(!nh_.getParam("MPRRT/shared_tree",shared_tree_))
+  {
+    ROS_ERROR("MPRRT/shared_tree not set, set false");
+    shared_tree_ = false;
+  }
 
-  //If the configuration matches to a node of the replanned path
-  for(const Eigen::VectorXd& wp:replanned_path->getWaypoints())
+  if(!nh_.getParam("MPRRT/shared_tree_capacity",shared_tree_capacity_))
   {
-    if((wp-configuration).norm()<TOLERANCE)
+    ROS_ERROR("MPRRT/shared_tree_capacity not set, set %d",SHARED_TREE_CAPACITY);
+    shared_tree_capacity_ = SHARED_TREE_CAPACITY;
+  }
+  else
+  {
+    if(shared_tree_capacity_<1)
     {
-      assert(wp != replanned_path->getWaypoints().back());
-      replanned_path = replanned_path->getSubpathFromNode(configuration);
-
-      return;
+      ROS_ERROR("MPRRT/shared_tree_capacity can not be less than 1, set %d",SHARED_TREE_CAPACITY);
+      shared_tree_capacity_ = SHARED_TREE_CAPACITY;
     }
   }
 
-  //Otherwise, if the configuration does not match to any path node..
-  PathPtr current_path = replanner_->getCurrentPath();
-
-  PathPtr path_conf2replanned;
-  int idx_current_conf, idx_replanned_path_start;
-
-  double abscissa_current_conf = current_path->curvilinearAbscissaOfPoint(configuration,idx_current_conf);
-  double abscissa_replanned_path_start = current_path->curvilinearAbscissaOfPoint(replanned_path_start_conf,idx_replanned_path_start);
-
-  assert(abscissa_current_conf != abscissa_replanned_path_start);
-
-  if(abscissa_current_conf < abscissa_replanned_path_start)  //the replanned path starts from a position after the current one
+  if(!nh_.getParam("MPRRT/tree_reuse",tree_reuse_))
   {
-    path_conf2replanned = current_path->clone();
-    NodePtr n1 = path_conf2replanned->addNodeAtCurrentConfig(configuration,true);
-    NodePtr n2 = path_conf2replanned->addNodeAtCurrentConfig(replanned_path_start_conf,true);
-
-    path_conf2replanned = path_conf2replanned->getSubpathFromNode(n1);
-    path_conf2replanned = path_conf2replanned->getSubpathToNode  (n2);
-
-    path_connections = path_conf2replanned->getConnections();
-
-    assert((path_connections.back()->getChild()->getConfiguration()-conn_replanned.front()->getParent()->getConfiguration()).norm()<TOLERANCE);
-
-    ConnectionPtr conn = std::make_shared<Connection>(path_connections.back()->getParent(),conn_replanned.front()->getParent(),false);
-    conn->setCost(path_connections.back()->getCost());
-    conn->add();
-
-    path_connections.back()->remove();
-    path_connections.pop_back();
-    path_connections.push_back(conn);
+    ROS_ERROR("MPRRT/tree_reuse not set, set false");
+    tree_reuse_ = false;
+  }
 
-    path_connections.insert(path_connections.end(),conn_replanned.begin(),conn_replanned.end());
+  if(!nh_.getParam("MPRRT/max_reused_tree_nodes",max_reused_tree_nodes_))
+  {
+    ROS_ERROR("MPRRT/max_reused_tree_nodes not set, set %d",MAX_REUSED_TREE_NODES);
+    max_reused_tree_nodes_ = MAX_REUSED_TREE_NODES;
   }
   else
   {
-    path_conf2replanned = current_path->clone();
-    NodePtr n1 = path_conf2replanned->addNodeAtCurrentConfig(replanned_path_start_conf,true);
-    NodePtr n2 = path_conf2replanned->addNodeAtCurrentConfig(configuration,true);
-
-    path_conf2replanned = path_conf2replanned->getSubpathFromNode(n1);
-    path_conf2replanned = current_path->getSubpathToNode(n2);
-
-    path_conf2replanned->flip();
-    path_connections = path_conf2replanned->getConnections();
-
-    ConnectionPtr conn = std::make_shared<Connection>(path_connections.back()->getParent(),conn_replanned.front()->getParent(),false);
-    conn->setCost(path_connections.back()->getCost());
-    conn->add();
-
-    path_connections.back()->remove();
-    path_connections.pop_back();
-    path_connections.push_back(conn);
-
-    path_connections.insert(path_connections.end(),conn_replanned.begin(),conn_replanned.end());
+    if(max_reused_tree_nodes_<1)
+    {
+      ROS_ERROR("MPRRT/max_reused_tree_nodes can not be less than 1, set %d",MAX_REUSED_TREE_NODES);
+      max_reused_tree_nodes_ = MAX_REUSED_TREE_NODES;
+    }
   }
+}
 
-  replanned_path->setConnections(path_connections);
-  replanned_path->simplify(0.01);
-
+void ReplannerManagerMPRRT::startReplannedPathFromNewCurrentConf(const Eigen::VectorXd& configuration)
+{
+  joinConfToReplannedPath(configuration);
 }
 
 bool ReplannerManagerMPRRT::haveToReplan(const bool path_obstructed)
@@ -118,10 +82,31 @@ bool ReplannerManagerMPRRT::haveToReplan(const bool path_obstructed)
   return alwaysReplan();
 }
 
+void ReplannerManagerMPRRT::splitCoreBudget()
+{
+  ReplannerManagerBase::splitCoreBudget();
+
+  if(core_budget_>0) //each parallel replanner clones the replanning checker, so its threads are shared among them
+  {
+    if(n_threads_replan_>checker_replanning_n_threads_)
+    {
+      ROS_WARN("n_threads_replan (%d) reduced to %d to respect the core budget",n_threads_replan_,checker_replanning_n_threads_);
+      n_threads_replan_ = checker_replanning_n_threads_;
+    }
+
+    n_replanning_checkers_ = n_threads_replan_;
+    checker_replanning_n_threads_ = std::max(1,checker_replanning_n_threads_/n_threads_replan_);
+  }
+}
+
 void ReplannerManagerMPRRT::initReplanner()
 {
   double time_for_repl = 0.9*dt_replan_;
-  replanner_ = std::make_shared<pathplan::MPRRT>(configuration_replan_, current_path_, time_for_repl, solver_,n_threads_replan_);
+  pathplan::MPRRTPtr replanner = std::make_shared<pathplan::MPRRT>(configuration_replan_, current_path_, time_for_repl, solver_,n_threads_replan_);
+  replanner->setSharedTree(shared_tree_,solver_->getMaxDistance(),shared_tree_capacity_);
+  replanner->setTreeReuse(tree_reuse_,max_reused_tree_nodes_);
+
+  replanner_ = replanner;
 }
 
 }
@@ -11,13 +11,295 @@ ReplannerManagerAnytimeDRRT::ReplannerManagerAnytimeDRRT(const PathPtr &current_
   tmp_solver->importFromSolver(solver);
 
   solver_  = tmp_solver;
+
+  improver_pause_ = false;
+  improver_candidate_ = nullptr;
+  improver_candidate_version_ = 0;
+
+  anytimeAdditionalParams();
+}
+
+void ReplannerManagerAnytimeDRRT::anytimeAdditionalParams()
+{
+  if(!nh_.getParam("anytimeDRRT/background_improvement",background_improvement_))
+  {
+    ROS_ERROR("anytimeDRRT/background_improvement not set, set false");
+    background_improvement_ = false;
+  }
+
+  if(!nh_.getParam("anytimeDRRT/improver_lookahead",improver_lookahead_))
+  {
+    ROS_ERROR("anytimeDRRT/improver_lookahead not set, set 0.1");
+    improver_lookahead_ = 0.1;
+  }
+  else
+  {
+    if(improver_lookahead_<0.0 || improver_lookahead_>=1.0)
+    {
+      ROS_ERROR("anytimeDRRT/improver_lookahead must be in [0,1), set 0.1");
+      improver_lookahead_ = 0.1;
+    }
+  }
 }
 
 bool ReplannerManagerAnytimeDRRT::haveToReplan(const bool path_obstructed)
 {
+  improver_pause_ = path_obstructed;  //the replanning needs the cores
   return alwaysReplan();
 }
 
+void ReplannerManagerAnytimeDRRT::splitCoreBudget()
+{
+  if(core_budget_<=0 || (not background_improvement_))
+  {
+    ReplannerManagerDRRT::splitCoreBudget();
+    return;
+  }
+
+  /* The improver checker is a clone of the replanning checker working at the same time as the replanning one (or the
+   * batch regrow clones), so the replanning threads are shared with it too */
+  ReplannerManagerBase::splitCoreBudget();
+  n_replanning_checkers_ = std::max(1,regrow_batch_size_)+1;
+  checker_replanning_n_threads_ = std::max(1,checker_replanning_n_threads_/n_replanning_checkers_);
+}
+
+void ReplannerManagerAnytimeDRRT::applyFallbackLevel(const int& level)
+{
+  ReplannerManagerBase::applyFallbackLevel(level);
+
+  /* At level 2 haveToReplan is not called, the pause is kept until the level decreases. From then on haveToReplan
+   * pauses the improver only while the path is obstructed */
+  improver_pause_ = (level == 2);
+}
+
+bool ReplannerManagerAnytimeDRRT::run()
+{
+  ReplannerManagerBase::run();
+
+  if(background_improvement_ && replanning_enabled_)
+  {
+    improver_thread_ = std::thread(&ReplannerManagerAnytimeDRRT::improverThread,this);
+    pinThread(improver_thread_,"improver");
+  }
+
+  return true;
+}
+
+bool ReplannerManagerAnytimeDRRT::joinThreads()
+{
+  ReplannerManagerBase::joinThreads();
+
+  if(improver_thread_.joinable())
+    improver_thread_.join();
+
+  return true;
+}
+
+void ReplannerManagerAnytimeDRRT::improverThread()
+{
+  MetricsPtr metrics = solver_->getMetrics()->clone();
+  CollisionCheckerPtr checker = checker_replanning_->clone();
+  Eigen::VectorXd lb = solver_->getSampler()->getLB();
+  Eigen::VectorXd ub = solver_->getSampler()->getUB();
+  SamplerPtr sampler = std::make_shared<InformedSampler>(lb,ub,lb,ub);
+
+  AnytimeRRTPtr solver = std::make_shared<AnytimeRRT>(metrics,checker,sampler);
+  if(not solver->config(nh_))
+  {
+    ROS_ERROR("Background improver: solver not configured, the improver is disabled");
+    return;
+  }
+
+  double max_distance;
+  if(!nh_.getParam("max_distance",max_distance))
+  {
+    ROS_ERROR("max_distance not set, set 0.5");
+    max_distance = 0.5;
+  }
+
+  PathSnapshotPtr snapshot;
+  PathPtr path, subpath, solution;
+  TreePtr tree;
+  moveit_msgs::PlanningScene scene_msg;
+  Eigen::VectorXd configuration_replan, start_conf;
+  Eigen::VectorXd goal_conf = replanner_->getGoal()->getConfiguration();
+  unsigned long last_update_id = 0;
+  unsigned long scene_world_version = 0;
+  bool scene_loaded = false;
+  double abscissa, path_cost, cost2beat;
+  int idx;
+
+  while((not stop_) && ros::ok())
+  {
+    if(improver_pause_ || (not download_scene_info_))
+    {
+      waitSceneUpdate(last_update_id,dt_replan_);
+      continue;
+    }
+
+    snapshot = getPathSnapshot();
+
+    replanner_mtx_.lock();
+    configuration_replan = configuration_replan_;
+    replanner_mtx_.unlock();
+
+    scene_mtx_.lock();
+    bool scene_changed = ((not scene_loaded) || scene_world_version != planning_scene_diff_world_version_);
+    if(scene_changed)
+    {
+      scene_msg = planning_scene_diff_msg_;
+      scene_world_version = planning_scene_diff_world_version_;
+    }
+    scene_mtx_.unlock();
+
+    if(scene_changed) //the world of the scene is reloaded only when it changes
+    {
+      checker->setPlanningSceneMsg(scene_msg);
+      scene_loaded = true;
+    }
+
+    abscissa = snapshot->getIndex()->curvilinearAbscissaOfPoint(configuration_replan,idx);
+    if(abscissa+improver_lookahead_>=1.0) //too close to the goal
+    {
+      waitSceneUpdate(last_update_id,dt_replan_);
+      continue;
+    }
+
+    start_conf = snapshot->getIndex()->pointOnCurvilinearAbscissa(abscissa+improver_lookahead_);
+
+    paths_mtx_.lock();
+    path_cost = current_path_shared_index_->getCostFromConf(start_conf);
+    paths_mtx_.unlock();
+
+    if(path_cost == std::numeric_limits<double>::infinity())
+    {
+      waitSceneUpdate(last_update_id,dt_replan_);
+      continue;
+    }
+
+    /* Same setup as AnytimeDynamicRRT::improvePath, on a private copy of the path */
+    subpath = snapshot->getPath()->getSubpathFromConf(start_conf,true);
+    subpath->setChecker(checker);
+
+    tree = std::make_shared<Tree>(subpath->getConnections().front()->getParent(),max_distance,checker,metrics);
+    tree->addBranch(subpath->getConnections());
+    subpath->setTree(tree);
+
+    solver->setStartTree(tree);
+    solver->setSolution(subpath,true);
+    solver->setPathCost(path_cost);
+
+    cost2beat = (1-solver->getCostImpr())*path_cost;
+
+    NodePtr start_node = makeNode(start_conf);
+    NodePtr goal_node  = makeNode(goal_conf);
+
+    if(solver->improve(start_node,goal_node,solution,cost2beat,10000,dt_replan_))
+    {
+      /* A pending improvement of the same path starts from an older start_conf, so the two are compared by the cost
+       * they save on the current path from their own start (an obstructed start means infinite savings) */
+      improver_mtx_.lock();
+      PathPtr pending = (improver_candidate_version_ == snapshot->getVersion())? improver_candidate_:nullptr;
+      improver_mtx_.unlock();
+
+      bool keep_pending = false;
+      if(pending)
+      {
+        paths_mtx_.lock();
+        double pending_saving = current_path_shared_index_->getCostFromConf(pending->getWaypoints().front())-pending->cost();
+        paths_mtx_.unlock();
+
+        keep_pending = (pending_saving>=path_cost-solution->cost());
+      }
+
+      if(not keep_pending)
+      {
+        improver_mtx_.lock();
+        improver_candidate_ = solution->clone(); //the solver tree is reused by the next improvements
+        improver_candidate_version_ = snapshot->getVersion();
+        improver_mtx_.unlock();
+      }
+
+      if(display_replanning_success_)
+        ROS_BOLDWHITE_STREAM("Background improver: cost "<<path_cost<<" -> "<<solution->cost());
+    }
+
+    waitSceneUpdate(last_update_id,dt_replan_); //leave the cores to the other threads until the next scene update
+  }
+
+  ROS_BOLDCYAN_STREAM("Improver thread is over");
+}
+
+PathPtr ReplannerManagerAnytimeDRRT::spliceImprovement(const PathPtr& improvement)
+{
+  /* current path from configuration_replan_ up to the improvement start, then the improvement */
+  Eigen::VectorXd improvement_start = improvement->getWaypoints().front();
+
+  double abscissa_start = current_path_->curvilinearAbscissaOfPoint(improvement_start);
+  if(abscissa_start<=current_path_->curvilinearAbscissaOfPoint(configuration_replan_))
+    return nullptr;  //the robot has already passed the start of the improvement
+
+  double old_cost = current_path_->getCostFromConf(configuration_replan_);
+  double new_cost = old_cost-current_path_->getCostFromConf(improvement_start)+improvement->cost();
+  if(new_cost>=old_cost)
+    return nullptr;
+
+  improvement->setChecker(checker_replanning_);
+  if(not improvement->isValid())  //checked with the current scene
+    return nullptr;
+
+  PathPtr head = current_path_->getSubpathFromConf(configuration_replan_,true)->getSubpathToConf(improvement_start,true);
+
+  std::vector<ConnectionPtr> connections = head->getConnections();
+  std::vector<ConnectionPtr> improvement_connections = improvement->getConnections();
+
+  ConnectionPtr first_conn = improvement_connections.front();
+  ConnectionPtr joint_conn = makeConnection(connections.back()->getChild(),first_conn->getChild());
+  joint_conn->setCost(first_conn->getCost());
+  first_conn->remove();
+  joint_conn->add();
+
+  connections.push_back(joint_conn);
+  connections.insert(connections.end(),improvement_connections.begin()+1,improvement_connections.end());
+
+  PathPtr new_path = std::make_shared<Path>(connections,solver_->getMetrics(),checker_replanning_);
+  TreePtr tree = std::make_shared<Tree>(connections.front()->getParent(),current_path_->getTree()->getMaximumDistance(),checker_replanning_,solver_->getMetrics());
+  tree->addBranch(connections);
+  new_path->setTree(tree);
+
+  return new_path;
+}
+
+bool ReplannerManagerAnytimeDRRT::replan()
+{
+  bool path_changed = ReplannerManagerBase::replan();
+
+  if(not background_improvement_)
+    return path_changed;
+
+  improver_mtx_.lock();
+  PathPtr improvement = improver_candidate_;
+  unsigned long improvement_version = improver_candidate_version_;
+  improver_candidate_ = nullptr;
+  improver_mtx_.unlock();
+
+  /* The improvement refers to the current path, it can be used only if the replanner has not changed it */
+  if(path_changed || improvement == nullptr || improvement_version != current_path_version_)
+    return path_changed;
+
+  PathPtr new_path = spliceImprovement(improvement);
+  if(new_path == nullptr)
+    return path_changed;
+
+  AnytimeDynamicRRTPtr replanner = std::static_pointer_cast<AnytimeDynamicRRT>(replanner_);
+  replanner->setImprovedPath(new_path);
+
+  if(display_replanning_success_)
+    ROS_BOLDWHITE_STREAM("Path improved by the background improver, cost: "<<new_path->cost());
+
+  return true;
+}
+
 void ReplannerManagerAnytimeDRRT::initReplanner()
 {  
   double time_for_repl = 0.9*dt_replan_;
@@ -105,6 +105,116 @@ void ReplannerManagerBase::fromParam()
     which_link_display_path_ = "";
   if(!nh_.getParam("benchmark",benchmark_))
     benchmark_ = false;
+
+  if(!nh_.getParam("real_time/enabled",real_time_enabled_))
+    real_time_enabled_ = false;
+  if(!nh_.getParam("real_time/priority",real_time_priority_))
+    real_time_priority_ = 80;
+  if(!nh_.getParam("real_time/lock_memory",real_time_lock_memory_))
+    real_time_lock_memory_ = true;
+  if(!nh_.getParam("real_time/stats_period",timing_stats_period_))
+    timing_stats_period_ = 0.0;
+  if(!nh_.getParam("real_time/stats_topic",timing_stats_topic_))
+    timing_stats_topic_ = "/trj_execution_thread_timing";
+  if(!nh_.getParam("real_time/stats_n_bins",timing_stats_n_bins_))
+    timing_stats_n_bins_ = 20;
+  if(!nh_.getParam("real_time/stats_bin_width",timing_stats_bin_width_))
+    timing_stats_bin_width_ = 50.0;
+
+  if(timing_stats_n_bins_<1 || timing_stats_bin_width_<=0.0)
+  {
+    ROS_ERROR("real_time/stats_n_bins and real_time/stats_bin_width should be positive, set 20 and 50");
+    timing_stats_n_bins_ = 20;
+    timing_stats_bin_width_ = 50.0;
+  }
+
+  cpu_affinity_.clear();
+  for(const std::string& thread_name:{"trajectory_execution","replanning","collision_check","display","benchmark","spawn_objects","improver"})
+  {
+    std::vector<int> cpus;
+    if(nh_.getParam("cpu_affinity/"+thread_name,cpus))
+      cpu_affinity_[thread_name] = cpus;
+  }
+
+  if(!nh_.getParam("replanning_wait_timeout",replanning_wait_timeout_))
+    replanning_wait_timeout_ = 0.01;
+  else if(replanning_wait_timeout_<=0.0)
+  {
+    ROS_ERROR("replanning_wait_timeout should be positive, set 0.01");
+    replanning_wait_timeout_ = 0.01;
+  }
+
+  if(!nh_.getParam("core_budget/n_cores",core_budget_))
+    core_budget_ = 0;
+  if(!nh_.getParam("core_budget/collision_check_share",core_budget_cc_share_))
+    core_budget_cc_share_ = 0.3;
+
+  if(core_budget_cc_share_<0.0 || core_budget_cc_share_>1.0)
+  {
+    ROS_ERROR("core_budget/collision_check_share should be between 0 and 1, set 0.3");
+    core_budget_cc_share_ = 0.3;
+  }
+
+  if(!nh_.getParam("sample_reservoir_size",sample_reservoir_size_))
+    sample_reservoir_size_ = 0;
+  else if(sample_reservoir_size_<0)
+  {
+    ROS_ERROR("sample_reservoir_size can not be negative, set 0");
+    sample_reservoir_size_ = 0;
+  }
+
+  if(!nh_.getParam("free_reservoir/size",free_reservoir_size_))
+    free_reservoir_size_ = 0;
+  if(!nh_.getParam("free_reservoir/bias",free_reservoir_bias_))
+    free_reservoir_bias_ = 0.1;
+
+  if(free_reservoir_size_<0)
+  {
+    ROS_ERROR("free_reservoir/size can not be negative, set 0");
+    free_reservoir_size_ = 0;
+  }
+  if(free_reservoir_bias_<0.0 || free_reservoir_bias_>1.0)
+  {
+    ROS_ERROR("free_reservoir/bias should be between 0 and 1, set 0.1");
+    free_reservoir_bias_ = 0.1;
+  }
+
+  if(!nh_.getParam("path_optimizer/enabled",path_optimizer_enabled_))
+    path_optimizer_enabled_ = false;
+  if(!nh_.getParam("path_optimizer/local_optimizer",path_optimizer_local_))
+    path_optimizer_local_ = false;
+  if(!nh_.getParam("path_optimizer/min_improvement",path_optimizer_min_impr_))
+    path_optimizer_min_impr_ = 0.02;
+
+  if(path_optimizer_min_impr_<0.0 || path_optimizer_min_impr_>=1.0)
+  {
+    ROS_ERROR("path_optimizer/min_improvement should be in [0,1), set 0.02");
+    path_optimizer_min_impr_ = 0.02;
+  }
+
+  if(!nh_.getParam("fallback/enabled",fallback_enabled_))
+    fallback_enabled_ = false;
+  if(!nh_.getParam("fallback/overruns_to_degrade",fallback_overruns_))
+    fallback_overruns_ = 3;
+  if(!nh_.getParam("fallback/cycles_to_restore",fallback_fits_))
+    fallback_fits_ = 10;
+  if(!nh_.getParam("fallback/time_scale",fallback_time_scale_))
+    fallback_time_scale_ = 0.5;
+  if(!nh_.getParam("fallback/stop_and_wait",fallback_stop_and_wait_))
+    fallback_stop_and_wait_ = true;
+
+  if(fallback_overruns_<1 || fallback_fits_<1)
+  {
+    ROS_ERROR("fallback/overruns_to_degrade and fallback/cycles_to_restore should be at least 1, set 3 and 10");
+    fallback_overruns_ = 3;
+    fallback_fits_ = 10;
+  }
+  if(fallback_time_scale_<=0.0 || fallback_time_scale_>1.0)
+  {
+    ROS_ERROR("fallback/time_scale should be in (0,1], set 0.5");
+    fallback_time_scale_ = 0.5;
+  }
+
   if(!nh_.getParam("virtual_obj/spawn_objs",spawn_objs_))
     spawn_objs_ = false;
   else
@@ -139,8 +249,22 @@ void ReplannerManagerBase::attributeInitialization()
   goal_reached_                    = false;
   download_scene_info_             = true ;
   current_path_sync_needed_        = false;
+  trj_exec_path_sync_needed_       = true ;
+  scene_update_id_                 = 0    ;
+  world_version_                   = 0    ;
+  cost_world_version_              = 0    ;
+  planning_scene_diff_world_version_ = 0  ;
+  current_path_version_            = 0    ;
+  cc_path_version_                 = 0    ;
+  cost_deltas_overflow_            = false;
   spline_order_                    = 3    ;
   replanning_time_                 = 0.0  ;
+  replanning_allocations_          = 0    ;
+  replanning_reused_               = 0    ;
+  fallback_level_                  = 0    ;
+  consecutive_overruns_            = 0    ;
+  consecutive_fits_                = 0    ;
+  fallback_hold_                   = false;
   scaling_                         = 1.0  ;
   real_time_                       = 0.0  ;
   t_                               = 0.0  ;
@@ -148,6 +272,7 @@ void ReplannerManagerBase::attributeInitialization()
   time_shift_                      = dt_replan_*K_OFFSET           ;
   t_replan_                        = t_+time_shift_                ;
   replanning_thread_frequency_     = 100.0                         ;
+  replanner_max_time_              = 0.9*dt_replan_                ;
   global_override_                 = 0.0                           ;
 
   if(group_name_.empty())
@@ -173,15 +298,33 @@ void ReplannerManagerBase::attributeInitialization()
   const robot_state::JointModelGroup* joint_model_group = state.getJointModelGroup(group_name_);
   std::vector<std::string> joint_names = joint_model_group->getActiveJointModelNames();
 
-  current_path_shared_ = current_path_->clone();
+  current_path_shared_   = current_path_->clone();
+  current_path_conns_    = current_path_->getConnections();
+  current_path_snapshot_ = std::make_shared<const PathSnapshot>(current_path_shared_,0);
+  current_path_shared_index_ = std::make_shared<PathIndex>(*current_path_snapshot_->getIndex());
+  cc_conn_hint_ = 0;
+
+  cost_deltas_ = std::make_shared<SPSCQueue<CostDelta>>(COST_DELTAS_QUEUE_SIZE);
 
-  checker_cc_         = std::make_shared<pathplan::ParallelMoveitCollisionChecker>(planning_scn_cc_,        group_name_,parallel_checker_n_threads_,checker_resolution_);
-  checker_replanning_ = std::make_shared<pathplan::ParallelMoveitCollisionChecker>(planning_scn_replanning_,group_name_,parallel_checker_n_threads_,checker_resolution_);
+  n_replanning_checkers_ = 1;
+  splitCoreBudget();
+  checkCoreBudget();
+
+  checker_cc_         = std::make_shared<pathplan::ParallelMoveitCollisionChecker>(planning_scn_cc_,        group_name_,checker_cc_n_threads_        ,checker_resolution_);
+  checker_replanning_ = std::make_shared<pathplan::ParallelMoveitCollisionChecker>(planning_scn_replanning_,group_name_,checker_replanning_n_threads_,checker_resolution_);
 
   current_path_shared_->setChecker(checker_cc_        );
   current_path_       ->setChecker(checker_replanning_);
   solver_             ->setChecker(checker_replanning_);
 
+  if(path_optimizer_enabled_ && path_optimizer_local_) //configured once, used by optimizePathAhead
+  {
+    path_local_optimizer_ = std::make_shared<PathLocalOptimizer>(checker_replanning_,solver_->getMetrics());
+    path_local_optimizer_->config(nh_);
+  }
+  else
+    path_local_optimizer_ = nullptr;
+
   trajectory_ = std::make_shared<pathplan::Trajectory>(current_path_shared_,nh_,planning_scn_replanning_,group_name_);
   robot_trajectory::RobotTrajectoryPtr trj = trajectory_->fromPath2Trj();
 
@@ -198,16 +341,41 @@ void ReplannerManagerBase::attributeInitialization()
   interpolator_.interpolate(ros::Duration(t_       ),pnt_         ,scaling);
   interpolator_.interpolate(ros::Duration(t_       ),pnt_unscaled_,scaling_from_param_);
 
+  switch(joint_names.size())
+  {
+  case 3:  point_from_positions_ = &ReplannerManagerBase::pointFromPositionsKernel<3> ; break;
+  case 6:  point_from_positions_ = &ReplannerManagerBase::pointFromPositionsKernel<6> ; break;
+  case 12: point_from_positions_ = &ReplannerManagerBase::pointFromPositionsKernel<12>; break;
+  case 18: point_from_positions_ = &ReplannerManagerBase::pointFromPositionsKernel<18>; break;
+  default: point_from_positions_ = &ReplannerManagerBase::pointFromPositionsKernel<Eigen::Dynamic>;
+  }
+
   Eigen::VectorXd point2project(joint_names.size());
   for(unsigned int i=0; i<pnt_replan_.positions.size();i++)
     point2project(i) = pnt_replan_.positions.at(i);
 
-  configuration_replan_  = current_path_shared_->projectOnPath(point2project);
+  int conn_idx;
+  configuration_replan_  = current_path_snapshot_->getIndex()->projectOnPath(point2project,conn_idx);
   current_configuration_ = current_path_shared_->getStartNode()->getConfiguration();
 
   initReplanner();
   replanner_->setVerbosity(replanner_verbosity_);
 
+  if(sample_reservoir_size_>0)
+  {
+    sample_reservoir_ = std::make_shared<SampleReservoir>(solver_->getSampler()->getLB().size(),sample_reservoir_size_);
+    replanner_->setSampleReservoir(sample_reservoir_);
+  }
+
+  if(free_reservoir_size_>0)
+  {
+    free_reservoir_ = std::make_shared<FreeConfigurationReservoir>(solver_->getSampler()->getLB().size(),free_reservoir_size_);
+    replanner_->setFreeConfigurationReservoir(free_reservoir_,free_reservoir_bias_);
+
+    GroupFootprintPtr footprint = std::make_shared<GroupFootprint>(planning_scn_cc_,group_name_);
+    free_reservoir_->setFootprint([footprint](const Eigen::VectorXd& conf){return footprint->box(conf);});
+  }
+
   obj_ids_.clear();
 
   new_joint_state_.position                 = pnt_.positions                  ;
@@ -222,6 +390,96 @@ void ReplannerManagerBase::attributeInitialization()
   new_joint_state_unscaled_.header.stamp    = ros::Time::now()                ;
 }
 
+void ReplannerManagerBase::splitCoreBudget()
+{
+  if(core_budget_<=0)
+  {
+    checker_cc_n_threads_         = parallel_checker_n_threads_;
+    checker_replanning_n_threads_ = parallel_checker_n_threads_;
+    return;
+  }
+
+  /* The checkers pools are sized once, so the budget is split between them here:
+   * the collision check thread needs a small constant share, the rest goes to the replanning */
+  checker_cc_n_threads_         = std::max(1,(int)std::round(core_budget_*core_budget_cc_share_));
+  checker_replanning_n_threads_ = std::max(1,core_budget_-checker_cc_n_threads_);
+
+  ROS_BOLDWHITE_STREAM("Core budget "<<core_budget_<<": "<<checker_cc_n_threads_<<" checker threads for collision check, "<<checker_replanning_n_threads_<<" for replanning");
+}
+
+void ReplannerManagerBase::recordWorldChange(const unsigned long& world_version)
+{
+  /* Tell the free configuration reservoir where the world has changed: the boxes of the objects added or moved, bounded
+   * by the spheres of their shapes. Called by the collision check thread with scene_mtx_ held, after checker_cc_ has
+   * been updated */
+  if(free_reservoir_ == nullptr)
+    return;
+
+  const double inf = std::numeric_limits<double>::infinity();
+  Eigen::AlignedBox3d everywhere(Eigen::Vector3d::Constant(-inf),Eigen::Vector3d::Constant(inf));
+
+  std::map<std::string,Eigen::AlignedBox3d> boxes;
+  const collision_detection::WorldConstPtr& world = checker_cc_->getPlanningScene()->getWorld();
+
+  Eigen::Vector3d center;
+  double radius;
+  for(const std::string& id:world->getObjectIds())
+  {
+    collision_detection::World::ObjectConstPtr object = world->getObject(id);
+
+    Eigen::AlignedBox3d& box = boxes[id];
+    for(unsigned int i=0;i<object->shapes_.size();i++)
+    {
+      if(object->shapes_[i]->type == shapes::OCTREE || object->shapes_[i]->type == shapes::PLANE) //unbounded
+      {
+        box = everywhere;
+        break;
+      }
+
+      shapes::computeShapeBoundingSphere(object->shapes_[i].get(),center,radius);
+      center = object->global_shape_poses_[i]*center;
+      box.extend(center-Eigen::Vector3d::Constant(radius));
+      box.extend(center+Eigen::Vector3d::Constant(radius));
+    }
+  }
+
+  std::vector<Eigen::AlignedBox3d> changed;
+  for(const std::pair<const std::string,Eigen::AlignedBox3d>& b:boxes)
+  {
+    std::map<std::string,Eigen::AlignedBox3d>::const_iterator it = cc_objects_boxes_.find(b.first);
+    if(it == cc_objects_boxes_.end() || not it->second.isApprox(b.second))
+      changed.push_back(b.second);
+  }
+
+  if(changed.empty() && boxes.size() == cc_objects_boxes_.size()) //something else has changed
+    changed.push_back(everywhere);
+
+  free_reservoir_->addWorldChange(world_version,changed);
+  cc_objects_boxes_ = boxes;
+}
+
+void ReplannerManagerBase::checkCoreBudget()
+{
+  /* Each checker has at least one thread, so with many clones or a small budget the split can exceed it */
+  if(core_budget_<=0)
+    return;
+
+  int n_threads = checker_cc_n_threads_+n_replanning_checkers_*checker_replanning_n_threads_;
+  if(n_threads>core_budget_)
+    ROS_WARN("core budget exceeded: %d checker threads (%d for collision check, %d replanning checkers with %d each) on %d cores",
+             n_threads,checker_cc_n_threads_,n_replanning_checkers_,checker_replanning_n_threads_,core_budget_);
+}
+
+void ReplannerManagerBase::pinThread(std::thread& thread, const std::string& name)
+{
+  std::map<std::string,std::vector<int>>::iterator it = cpu_affinity_.find(name);
+  if(it != cpu_affinity_.end())
+  {
+    if(not setThreadAffinity(thread.native_handle(),it->second))
+      ROS_ERROR_STREAM(name<<" thread not pinned");
+  }
+}
+
 void ReplannerManagerBase::overrideCallback(const std_msgs::Int64ConstPtr& msg, const std::string& override_name)
 {
   double ovr;
@@ -258,6 +516,9 @@ void ReplannerManagerBase::subscribeTopicsAndServices()
   target_pub_          = nh_.advertise<sensor_msgs::JointState>(joint_target_topic_,         10);
   unscaled_target_pub_ = nh_.advertise<sensor_msgs::JointState>(unscaled_joint_target_topic_,10);
 
+  if(timing_stats_period_>0.0)
+    trj_exec_timing_pub_ = nh_.advertise<std_msgs::Float64MultiArray>(timing_stats_topic_,1);
+
   if(benchmark_)
     text_overlay_pub_ = nh_.advertise<jsk_rviz_plugins::OverlayText>("/rviz_text_overlay_replanner_bench",1);
 
@@ -299,14 +560,51 @@ void ReplannerManagerBase::updateSharedPath()
   current_path_shared_ = current_path_->clone();
   current_path_shared_->setChecker(checker_cc_);
   current_path_sync_needed_ = true;
+  trj_exec_path_sync_needed_ = true;
+
+  current_path_version_++;
+  current_path_conns_ = current_path_->getConnections();
+  current_path_snapshot_ = std::make_shared<const PathSnapshot>(current_path_shared_,current_path_version_);
+  current_path_shared_index_ = std::make_shared<PathIndex>(*current_path_snapshot_->getIndex());
 
   download_scene_info_ = false;
 }
 
 void ReplannerManagerBase::downloadPathCost()
 {
-  paths_mtx_.lock();
+  if(cost_deltas_overflow_) //some deltas have been lost, copy all the costs from the shared path
+  {
+    paths_mtx_.lock();
+    cost_deltas_overflow_ = false;
+    cost_deltas_->clear();
+    syncPathCost();
+    paths_mtx_.unlock();
+  }
+  else
+  {
+    CostDelta delta;
+    while(cost_deltas_->pop(delta))
+      applyCostDelta(delta);
+  }
+
+  current_path_->cost(); //update path cost
+}
 
+void ReplannerManagerBase::applyCostDelta(const CostDelta& delta)
+{
+  if(delta.path_id == 0 && delta.path_version == current_path_version_ && delta.conn_id<current_path_conns_.size())
+  {
+    const std::vector<ConnectionPtr>& conns = current_path_->getConnectionsConst();
+    if(delta.conn_id<conns.size() && conns[delta.conn_id] == current_path_conns_[delta.conn_id]) //the connection is still in the path
+      conns[delta.conn_id]->setCost(delta.cost);
+  }
+
+  if(delta.world_version>cost_world_version_)
+    cost_world_version_ = delta.world_version;
+}
+
+void ReplannerManagerBase::syncPathCost()
+{
   std::vector<ConnectionPtr> current_path_conn        = current_path_       ->getConnections();
   std::vector<ConnectionPtr> current_path_shared_conn = current_path_shared_->getConnections();
 
@@ -327,34 +625,90 @@ void ReplannerManagerBase::downloadPathCost()
       break;
   }
 
-  current_path_->cost(); //update path cost
+  cost_world_version_ = world_version_;
+}
+
+PathSnapshotPtr ReplannerManagerBase::getPathSnapshot()
+{
+  paths_mtx_.lock();
+  PathSnapshotPtr snapshot = current_path_snapshot_;
   paths_mtx_.unlock();
+
+  return snapshot;
 }
 
-bool ReplannerManagerBase::uploadPathCost(const PathPtr& current_path_updated_copy)
+double ReplannerManagerBase::sharedConnectionCost(const PathSnapshotPtr& snapshot, const int& conn_idx)
 {
-  bool updated = true;
+  double cost;
 
   paths_mtx_.lock();
-  if(not current_path_sync_needed_)
+  if(snapshot->getVersion() == current_path_version_)
+    cost = current_path_shared_->getConnectionsConst().at(conn_idx)->getCost(); //updated by the collision check thread
+  else
+    cost = snapshot->getPath()->getConnectionsConst().at(conn_idx)->getCost();
+  paths_mtx_.unlock();
+
+  return cost;
+}
+
+std::vector<double> ReplannerManagerBase::connectionsCost(const PathPtr& path)
+{
+  std::vector<double> costs;
+  costs.reserve(path->getConnectionsSize());
+
+  for(const ConnectionPtr& conn:path->getConnectionsConst())
+    costs.push_back(conn->getCost());
+
+  return costs;
+}
+
+void ReplannerManagerBase::uploadConnectionsCost(const unsigned int& path_id, const unsigned long& path_version, const PathPtr& shared_path, const PathIndexPtr& shared_index,
+                                                 const PathPtr& path_updated_copy, std::vector<double>& last_costs)
+{
+  const std::vector<ConnectionPtr>& shared_conns = shared_path      ->getConnectionsConst();
+  const std::vector<ConnectionPtr>& copy_conns   = path_updated_copy->getConnectionsConst();
+
+  assert(shared_conns.size() == copy_conns.size() && last_costs.size() == copy_conns.size());
+
+  CostDelta delta;
+  delta.path_id       = path_id       ;
+  delta.path_version  = path_version  ;
+  delta.world_version = world_version_;
+
+  bool changed = false;
+  for(unsigned int j=0;j<copy_conns.size();j++)
   {
-    std::vector<ConnectionPtr> current_path_conns      = current_path_shared_     ->getConnections();
-    std::vector<ConnectionPtr> current_path_copy_conns = current_path_updated_copy->getConnections();
-    for(unsigned int z=0;z<current_path_conns.size();z++)
+    delta.cost = copy_conns[j]->getCost();
+    if(delta.cost != last_costs[j])
     {
-      assert(current_path_conns.size() == current_path_copy_conns.size());
-      assert((current_path_conns.at(z)->getParent()->getConfiguration() == current_path_copy_conns.at(z)->getParent()->getConfiguration()) &&
-             (current_path_conns.at(z)->getChild() ->getConfiguration() == current_path_copy_conns.at(z)->getChild() ->getConfiguration()));
+      shared_conns[j]->setCost(delta.cost);
+      last_costs[j] = delta.cost;
 
-      current_path_conns.at(z)->setCost(current_path_copy_conns.at(z)->getCost());
-    }
-    current_path_shared_->cost();
+      if(shared_index)
+        shared_index->setConnectionCost(j,delta.cost);
+      changed = true;
 
+      delta.conn_id = j;
+      if(not cost_deltas_->push(delta))
+        cost_deltas_overflow_ = true;
+    }
   }
+
+  if(changed)
+    shared_path->cost();
+}
+
+bool ReplannerManagerBase::uploadPathCost(const PathPtr& current_path_updated_copy)
+{
+  bool updated = true;
+
+  paths_mtx_.lock();
+  if(not current_path_sync_needed_)
+    uploadConnectionsCost(0,cc_path_version_,current_path_shared_,current_path_shared_index_,current_path_updated_copy,cc_path_costs_);
   else
     updated = false;
 
-  if(current_path_shared_->getCostFromConf(current_configuration_) == std::numeric_limits<double>::infinity() && (display_timing_warning_ || display_replanning_success_))
+  if(current_path_shared_index_->getCostFromConf(current_configuration_,cc_conn_hint_,cc_conn_hint_) == std::numeric_limits<double>::infinity() && (display_timing_warning_ || display_replanning_success_))
     ROS_BOLDMAGENTA_STREAM("Obstacle detected!");
 
   paths_mtx_.unlock();
@@ -401,24 +755,27 @@ bool ReplannerManagerBase::updateTrajectory()
 
 void ReplannerManagerBase::replanningThread()
 {
-  ros::WallRate lp(replanning_thread_frequency_);
-  ros::WallRate fast_lp(2000);
-
   ros::WallTime tic,toc,tic_rep,toc_rep;
+  unsigned long last_update_id = 0;
 
-  PathPtr path2project_on;
+  PathSnapshotPtr snapshot;
   Eigen::VectorXd current_configuration;
   Eigen::VectorXd point2project(pnt_replan_.positions.size());
 
+  unsigned long snapshot_version = 0;
+  int replan_conn_hint = 0, current_conn_hint = 0;
+
   int n_size_before;
   bool success = false;
   bool path_changed = false;
   bool path_obstructed = true;
   double replanning_duration = 0.0;
-  double duration, abscissa_current_configuration, abscissa_replan_configuration;
+  double duration, goal_distance, abscissa_current_configuration, abscissa_replan_configuration;
+  GraphPoolStats pool_stats, pool_stats_before;
+  unsigned long replanning_world_version = 0;
+  trajectory_processing::SplineInterpolator trj_interpolator;
 
   Eigen::VectorXd projection = configuration_replan_;
-  Eigen::VectorXd past_projection = configuration_replan_;
   Eigen::VectorXd goal_conf = replanner_->getGoal()->getConfiguration();
 
   while((not stop_) && ros::ok())
@@ -427,33 +784,36 @@ void ReplannerManagerBase::replanningThread()
 
     if(not download_scene_info_)
     {
-      fast_lp.sleep(); //wait for 0.5 ms
+      waitSceneUpdate(last_update_id,replanning_wait_timeout_); //wait for the collision check thread to check the new path
       continue;
     }
 
     trj_mtx_.lock();
 
     interpolator_.interpolate(ros::Duration(t_replan_),pnt_replan_,scaling_);
-    for(unsigned int i=0; i<pnt_replan_.positions.size();i++)
-      point2project(i) = pnt_replan_.positions.at(i);
+    goal_distance = pointFromPositions(pnt_replan_.positions,goal_conf,point2project);
 
     current_configuration = current_configuration_;
     trj_mtx_.unlock();
 
-    if((point2project-goal_conf).norm()>goal_tol_)
+    if(goal_distance>goal_tol_)
     {
-      paths_mtx_.lock();
-      path2project_on = current_path_shared_->clone();
-      paths_mtx_.unlock();
+      snapshot = getPathSnapshot();
+      const PathIndexConstPtr& path_index = snapshot->getIndex();
 
-      projection = path2project_on->projectOnPath(point2project,past_projection,false);
-      past_projection = projection;
+      if(snapshot->getVersion() != snapshot_version) //hints refer to the previous path, the projection restarts from the current configuration
+      {
+        snapshot_version = snapshot->getVersion();
+        replan_conn_hint = current_conn_hint = path_index->locate(current_configuration);
+      }
+
+      path_index->projectOnPath(point2project,projection,replan_conn_hint,replan_conn_hint);
 
-      abscissa_replan_configuration = path2project_on->curvilinearAbscissaOfPoint(projection);
-      abscissa_current_configuration = path2project_on->curvilinearAbscissaOfPoint(current_configuration);
+      abscissa_replan_configuration  = path_index->curvilinearAbscissaOfPoint(projection           ,replan_conn_hint ,replan_conn_hint );
+      abscissa_current_configuration = path_index->curvilinearAbscissaOfPoint(current_configuration,current_conn_hint,current_conn_hint);
 
       if(abscissa_replan_configuration <= abscissa_current_configuration+0.01)
-        projection = path2project_on->pointOnCurvilinearAbscissa(abscissa_current_configuration+0.01);  //1% step forward
+        path_index->pointOnCurvilinearAbscissa(abscissa_current_configuration+0.01,projection);  //1% step forward
 
       replanner_mtx_.lock();
       configuration_replan_ = projection;
@@ -461,12 +821,13 @@ void ReplannerManagerBase::replanningThread()
 
       scene_mtx_.lock();
       checker_replanning_->setPlanningSceneMsg(planning_scene_diff_msg_);
+      replanning_world_version = planning_scene_diff_world_version_;
       downloadPathCost();
       planning_scene_msg_benchmark_ = planning_scene_msg_;
       scene_mtx_.unlock();
 
       replanner_mtx_.lock();
-      if(not (current_path_->findConnection(configuration_replan_)))
+      if(path_index->findConnection(configuration_replan_,replan_conn_hint)<0) //the snapshot has the geometry of current_path_
       {
         ROS_BOLDYELLOW_STREAM("configuration replan not found on path");
         trj_mtx_.lock();
@@ -477,6 +838,7 @@ void ReplannerManagerBase::replanningThread()
       replanner_->setCurrentPath(current_path_);
       replanner_->setChecker(checker_replanning_);
       replanner_->setCurrentConf(configuration_replan_);
+      replanner_->setWorldVersion(replanning_world_version);
 
       path_obstructed = (current_path_->getCostFromConf(configuration_replan_) == std::numeric_limits<double>::infinity());
       replanner_mtx_.unlock();
@@ -485,14 +847,40 @@ void ReplannerManagerBase::replanningThread()
       path_changed = false;
       replanning_duration = 0.0;
 
-      if(haveToReplan(path_obstructed))
+      if(fallback_level_ == 2) //cheapest mode
+      {
+        if(path_obstructed)
+        {
+          tic_rep=ros::WallTime::now();
+          PathPtr direct_path = directConnectionPath(replanner_max_time_);
+          replanning_duration = (ros::WallTime::now()-tic_rep).toSec();
+
+          if(direct_path)
+          {
+            replanner_->setReplannedPath(direct_path);
+            success = path_changed = true;
+          }
+
+          fallback_hold_ = (not success) && fallback_stop_and_wait_;
+        }
+        else
+          fallback_hold_ = false;
+      }
+      else if(haveToReplan(path_obstructed))
       {
         n_size_before = current_path_->getConnectionsSize();
+        pool_stats_before = graphPoolStats();
 
         tic_rep=ros::WallTime::now();
         path_changed = replan();      //path may have changed even though replanning was unsuccessful
         toc_rep=ros::WallTime::now();
 
+        pool_stats = graphPoolStats();
+        bench_mtx_.lock();
+        replanning_allocations_ = pool_stats.allocations-pool_stats_before.allocations;
+        replanning_reused_      = pool_stats.reused     -pool_stats_before.reused;
+        bench_mtx_.unlock();
+
         replanning_duration = (toc_rep-tic_rep).toSec();
         success = replanner_->getSuccess();
 
@@ -503,40 +891,61 @@ void ReplannerManagerBase::replanningThread()
 
         assert(((not path_changed) && (n_size_before == current_path_->getConnectionsSize())) || (path_changed));
       }
+      else if(path_optimizer_enabled_ && (not path_obstructed)) //idle cycle, improve the path ahead
+      {
+        tic_rep=ros::WallTime::now();
+        PathPtr optimized_path = optimizePathAhead(0.9*dt_replan_);
+        replanning_duration = (ros::WallTime::now()-tic_rep).toSec();
+
+        if(optimized_path)
+        {
+          replanner_->setReplannedPath(optimized_path);
+          success = path_changed = true;
+
+          if(display_replanning_success_)
+            ROS_BOLDWHITE_STREAM("Path optimized, cost: "<<optimized_path->cost());
+        }
+      }
 
       if(replanning_duration>=dt_replan_/0.9 && display_timing_warning_)
         ROS_BOLDYELLOW_STREAM("Replanning duration: "<<replanning_duration);
+
       if(display_replanning_success_)
+      {
         ROS_BOLDWHITE_STREAM("Success: "<< success <<" in "<< replanning_duration <<" seconds");
+        if(replanning_duration>0.0)
+          ROS_BOLDWHITE_STREAM("Nodes/connections allocated: "<<replanning_allocations_<<" ("<<replanning_reused_<<" from the pool)");
+      }
 
       if(path_changed && (not stop_))
       {
+        /* The trajectory execution thread takes trj_mtx_ every cycle, so the new trajectory is computed outside it and
+         * only swapped in under the lock */
         trj_mtx_.lock();
         Eigen::VectorXd current_conf = current_configuration_;
-        startReplannedPathFromNewCurrentConf(current_conf);
         trj_mtx_.unlock();
 
+        startReplannedPathFromNewCurrentConf(current_conf);
         PathPtr trj_path = trjPath(replanner_->getReplannedPath());
 
         replanner_mtx_.lock();
-        trj_mtx_.lock();
-
-        tic_trj_ = ros::WallTime::now();
 
         if(success)
         {
+          trj_mtx_.lock();
+          pnt_trj_ = pnt_;
+          tic_trj_ = ros::WallTime::now();
+          trj_mtx_.unlock();
+
           trajectory_->setPath(trj_path);
 
-          robot_trajectory::RobotTrajectoryPtr trj= trajectory_->fromPath2Trj(pnt_);
+          robot_trajectory::RobotTrajectoryPtr trj= trajectory_->fromPath2Trj(pnt_trj_);
 
           moveit_msgs::RobotTrajectory tmp_trj_msg;
           trj->getRobotTrajectoryMsg(tmp_trj_msg);
 
-          interpolator_.setTrajectory(tmp_trj_msg)   ;
-          interpolator_.setSplineOrder(spline_order_);
-
-          t_ = scaling_*((ros::WallTime::now()-tic_trj_).toSec()+dt_); //0.0
-          t_replan_ = t_+time_shift_;
+          trj_interpolator.setTrajectory(tmp_trj_msg)   ;
+          trj_interpolator.setSplineOrder(spline_order_);
         }
 
         current_path_ = replanner_->getReplannedPath();
@@ -546,15 +955,24 @@ void ReplannerManagerBase::replanningThread()
         updateSharedPath();
         paths_mtx_.unlock();
 
-        past_projection = current_conf;
+        if(success)
+        {
+          trj_mtx_.lock();
+          std::swap(interpolator_,trj_interpolator);
+          t_ = scaling_*((ros::WallTime::now()-tic_trj_).toSec()+dt_); //the new trajectory starts from pnt_trj_ at tic_trj_
+          t_replan_ = t_+time_shift_;
+          trj_mtx_.unlock();
+        }
 
-        trj_mtx_.unlock();
         replanner_mtx_.unlock();
       }
 
       toc=ros::WallTime::now();
       duration = (toc-tic).toSec();
 
+      if(fallback_enabled_) //the whole cycle has to fit dt_replan_, not only the replanning
+        updateFallbackLevel(duration);
+
       if(display_timing_warning_ && duration>(dt_replan_/0.9))
       {
         ROS_BOLDYELLOW_STREAM("Replanning thread time expired: duration-> "<<duration);
@@ -562,19 +980,46 @@ void ReplannerManagerBase::replanningThread()
       }
     }
 
-    lp.sleep();
+    /* Start the next cycle as soon as new cost information is available, or at most after replanning_wait_timeout_ */
+    duration = (ros::WallTime::now()-tic).toSec();
+    if(duration<replanning_wait_timeout_)
+      waitSceneUpdate(last_update_id,replanning_wait_timeout_-duration);
   }
 
   ROS_BOLDCYAN_STREAM("Replanning thread is over");
 }
 
+void ReplannerManagerBase::notifySceneUpdate()
+{
+  scene_update_mtx_.lock();
+  scene_update_id_++;
+  scene_update_mtx_.unlock();
+
+  scene_update_cv_.notify_all();
+}
+
+bool ReplannerManagerBase::waitSceneUpdate(unsigned long& last_update_id, const double& timeout)
+{
+  std::unique_lock<std::mutex> lock(scene_update_mtx_);
+  bool updated = scene_update_cv_.wait_for(lock,std::chrono::duration<double>(timeout),[&]()->bool{
+    return (scene_update_id_ != last_update_id || stop_);
+  });
+
+  last_update_id = scene_update_id_;
+  return updated;
+}
+
 void ReplannerManagerBase::collisionCheckThread()
 {
   moveit_msgs::GetPlanningScene ps_srv;
   Eigen::VectorXd current_configuration_copy;
 
+  paths_mtx_.lock();
   PathPtr current_path_copy = current_path_shared_->clone();
   current_path_copy->setChecker(checker_cc_);
+  cc_path_version_ = current_path_version_;
+  cc_path_costs_ = connectionsCost(current_path_copy);
+  paths_mtx_.unlock();
 
   double duration;
   ros::WallTime tic,toc;
@@ -597,23 +1042,31 @@ void ReplannerManagerBase::collisionCheckThread()
     }
 
     scene_mtx_.lock();
+    bool world_changed = (planning_scene_msg.world != ps_srv.response.scene.world);
+    if(world_changed)
+      world_version_++;
+
     planning_scene_msg.world = ps_srv.response.scene.world;
     planning_scene_msg.is_diff = true;
     checker_cc_->setPlanningSceneMsg(planning_scene_msg);
-    scene_mtx_.unlock();
 
-    trj_mtx_.lock();
-
-    current_configuration_copy = current_configuration_;
+    if(world_changed)
+      recordWorldChange(world_version_);
+    scene_mtx_.unlock();
 
     paths_mtx_.lock();
     if(current_path_sync_needed_)
     {
       current_path_copy = current_path_shared_->clone();
       current_path_copy->setChecker(checker_cc_);
+      cc_path_version_ = current_path_version_;
+      cc_path_costs_ = connectionsCost(current_path_copy);
       current_path_sync_needed_ = false;
     }
     paths_mtx_.unlock();
+
+    trj_mtx_.lock(); //not held while cloning, the trajectory execution thread takes it every cycle
+    current_configuration_copy = current_configuration_;
     trj_mtx_.unlock();
 
     if((current_configuration_copy-replanner_->getGoal()->getConfiguration()).norm()<goal_tol_)
@@ -634,11 +1087,14 @@ void ReplannerManagerBase::collisionCheckThread()
     {
       planning_scene_msg_.world = ps_srv.response.scene.world;  //not diff,it contains all pln scn info but only world is updated
       planning_scene_diff_msg_ = planning_scene_msg;            //diff, contains only world
+      planning_scene_diff_world_version_ = world_version_;
 
       download_scene_info_ = true;      //dowloadPathCost can be called because the scene and path cost are referred now to the last path found
     }
     scene_mtx_.unlock();
 
+    notifySceneUpdate();
+
     toc=ros::WallTime::now();
     duration = (toc-tic).toSec();
 
@@ -656,6 +1112,383 @@ bool ReplannerManagerBase::replan()
   return replanner_->replan();
 }
 
+template<int DOF>
+double ReplannerManagerBase::pointFromPositionsKernel(const std::vector<double>& positions, const Eigen::VectorXd& goal, Eigen::VectorXd& point) const
+{
+  typedef Eigen::Matrix<double,DOF,1> Vector;
+
+  Eigen::Map<const Vector> q(positions.data(),positions.size());
+  Eigen::Map<Vector>(point.data(),point.size()) = q;
+
+  return (q-Eigen::Map<const Vector>(goal.data(),goal.size())).norm();
+}
+
+void ReplannerManagerBase::updateFallbackLevel(const double& cycle_duration)
+{
+  if(cycle_duration>dt_replan_)
+  {
+    consecutive_fits_ = 0;
+    if(++consecutive_overruns_>=fallback_overruns_ && fallback_level_<2)
+    {
+      consecutive_overruns_ = 0;
+      applyFallbackLevel(fallback_level_+1);
+
+      ROS_BOLDYELLOW_STREAM("Replanning overruns, fallback level "<<fallback_level_);
+    }
+  }
+  else
+  {
+    consecutive_overruns_ = 0;
+    if(++consecutive_fits_>=fallback_fits_ && fallback_level_>0)
+    {
+      consecutive_fits_ = 0;
+      applyFallbackLevel(fallback_level_-1);
+
+      ROS_BOLDWHITE_STREAM("Replanning within the budget, fallback level "<<fallback_level_);
+    }
+  }
+}
+
+void ReplannerManagerBase::applyFallbackLevel(const int& level)
+{
+  fallback_level_ = level;
+
+  (level == 0)?
+        (replanner_max_time_ = 0.9*dt_replan_):
+        (replanner_max_time_ = fallback_time_scale_*0.9*dt_replan_);
+
+  replanner_mtx_.lock();
+  replanner_->setMaxTime(replanner_max_time_);
+  replanner_mtx_.unlock();
+
+  if(level<2)
+    fallback_hold_ = false;
+}
+
+PathPtr ReplannerManagerBase::directConnectionPath(const double& max_time)
+{
+  /* Connect configuration_replan_ straight to the farthest node of the current path which is beyond the last obstructed
+   * connection and visible from it, the rest of the current path is kept */
+  ros::WallTime tic = ros::WallTime::now();
+
+  std::vector<ConnectionPtr> connections = current_path_->getConnections();
+
+  int idx;
+  current_path_->curvilinearAbscissaOfPoint(configuration_replan_,idx);
+
+  int last_obstructed = -1;
+  for(int k=idx;k<(int)connections.size();k++)
+  {
+    if(connections[k]->getCost() == std::numeric_limits<double>::infinity())
+      last_obstructed = k;
+  }
+
+  if(last_obstructed<0)
+    return nullptr;
+
+  for(int k=connections.size()-1;k>=last_obstructed;k--)
+  {
+    if((ros::WallTime::now()-tic).toSec()>=max_time)
+      break;
+
+    if(not checker_replanning_->checkPath(configuration_replan_,connections[k]->getChild()->getConfiguration()))
+      continue;
+
+    //The nodes of the current path from the target to the goal are kept
+    std::vector<Eigen::VectorXd> waypoints(1,configuration_replan_);
+    std::vector<NodePtr> nodes(1,nullptr);
+    for(unsigned int h=k;h<connections.size();h++)
+    {
+      waypoints.push_back(connections[h]->getChild()->getConfiguration());
+      nodes.push_back(connections[h]->getChild());
+    }
+
+    return spliceIntoCurrentPath(waypoints,nodes);
+  }
+
+  return nullptr;
+}
+
+void ReplannerManagerBase::joinConfToReplannedPath(const Eigen::VectorXd& configuration)
+{
+  std::vector<pathplan::ConnectionPtr> path_connections;
+  PathPtr replanned_path = replanner_->getReplannedPath();
+  Eigen::VectorXd replanned_path_start_conf = replanned_path->getStartNode()->getConfiguration();
+  std::vector<ConnectionPtr> conn_replanned = replanned_path->getConnections();
+
+  //If the configuration matches to a node of the replanned path
+  for(const Eigen::VectorXd& wp:replanned_path->getWaypoints())
+  {
+    if((wp-configuration).norm()<TOLERANCE)
+    {
+      assert(wp != replanned_path->getWaypoints().back());
+      replanned_path = replanned_path->getSubpathFromNode(configuration);
+
+      return;
+    }
+  }
+
+  //Otherwise, if the configuration does not match to any path node..
+  PathPtr current_path = replanner_->getCurrentPath();
+
+  PathPtr path_conf2replanned;
+  int idx_current_conf, idx_replanned_path_start;
+
+  double abscissa_current_conf = current_path->curvilinearAbscissaOfPoint(configuration,idx_current_conf);
+  double abscissa_replanned_path_start = current_path->curvilinearAbscissaOfPoint(replanned_path_start_conf,idx_replanned_path_start);
+
+  assert(abscissa_current_conf != abscissa_replanned_path_start);
+
+  if(abscissa_current_conf < abscissa_replanned_path_start)  //the replanned path starts from a position after the current one
+  {
+    path_conf2replanned = current_path->clone();
+    NodePtr n1 = path_conf2replanned->addNodeAtCurrentConfig(configuration,true);
+    NodePtr n2 = path_conf2replanned->addNodeAtCurrentConfig(replanned_path_start_conf,true);
+
+    path_conf2replanned = path_conf2replanned->getSubpathFromNode(n1);
+    path_conf2replanned = path_conf2replanned->getSubpathToNode  (n2);
+
+    path_connections = path_conf2replanned->getConnections();
+
+    assert((path_connections.back()->getChild()->getConfiguration()-conn_replanned.front()->getParent()->getConfiguration()).norm()<TOLERANCE);
+
+    ConnectionPtr conn = makeConnection(path_connections.back()->getParent(),conn_replanned.front()->getParent(),false);
+    conn->setCost(path_connections.back()->getCost());
+    conn->add();
+
+    path_connections.back()->remove();
+    path_connections.pop_back();
+    path_connections.push_back(conn);
+
+    path_connections.insert(path_connections.end(),conn_replanned.begin(),conn_replanned.end());
+  }
+  else
+  {
+    path_conf2replanned = current_path->clone();
+    NodePtr n1 = path_conf2replanned->addNodeAtCurrentConfig(replanned_path_start_conf,true);
+    NodePtr n2 = path_conf2replanned->addNodeAtCurrentConfig(configuration,true);
+
+    path_conf2replanned = path_conf2replanned->getSubpathFromNode(n1);
+    path_conf2replanned = current_path->getSubpathToNode(n2);
+
+    path_conf2replanned->flip();
+    path_connections = path_conf2replanned->getConnections();
+
+    ConnectionPtr conn = makeConnection(path_connections.back()->getParent(),conn_replanned.front()->getParent(),false);
+    conn->setCost(path_connections.back()->getCost());
+    conn->add();
+
+    path_connections.back()->remove();
+    path_connections.pop_back();
+    path_connections.push_back(conn);
+
+    path_connections.insert(path_connections.end(),conn_replanned.begin(),conn_replanned.end());
+  }
+
+  replanned_path->setConnections(path_connections);
+  replanned_path->simplify(0.01);
+}
+
+PathPtr ReplannerManagerBase::spliceIntoCurrentPath(const std::vector<Eigen::VectorXd>& waypoints, const std::vector<NodePtr>& nodes)
+{
+  /* waypoints[0] is configuration_replan_, nodes[k] is the node of the current path at waypoints[k] or nullptr for a new
+   * configuration, the last one is the goal node. The replanners keep references to the goal node and to the tree of the
+   * current path, so the new path is built in that tree: configuration_replan_ is inserted as a node of the current path,
+   * the connections of the current path between consecutive nodes are kept, the other nodes of the current path are
+   * reparented and the new configurations are added as new nodes */
+  assert(waypoints.size() == nodes.size() && nodes.back() == current_path_->getGoalNode());
+
+  MetricsPtr metrics = solver_->getMetrics();
+  TreePtr tree = current_path_->getTree();
+
+  bool is_a_new_node;
+  ConnectionPtr replan_conn = current_path_->findConnection(configuration_replan_);
+  NodePtr parent = current_path_->addNodeAtCurrentConfig(configuration_replan_,replan_conn,true,is_a_new_node);
+
+  std::vector<ConnectionPtr> connections;
+  ConnectionPtr conn;
+  NodePtr child;
+  for(unsigned int k=1;k<waypoints.size();k++)
+  {
+    child = nodes[k];
+    conn = nullptr;
+
+    if(child == nullptr)
+    {
+      child = makeNode(waypoints[k]);
+      if(tree)
+        tree->addNode(child,false);
+    }
+    else if(child->getParentConnectionsSize()>0)
+    {
+      if(child->parentConnection(0)->getParent() == parent)
+        conn = child->parentConnection(0); //unchanged connection of the current path
+      else
+        child->parentConnection(0)->remove();
+    }
+
+    if(conn == nullptr)
+    {
+      conn = makeConnection(parent,child);
+      conn->setCost(metrics->cost(parent,child));
+      conn->add();
+    }
+
+    connections.push_back(conn);
+    parent = child;
+  }
+
+  PathPtr path = std::make_shared<Path>(connections,metrics,checker_replanning_);
+  if(tree == nullptr)
+  {
+    tree = std::make_shared<Tree>(connections.front()->getParent(),solver_->getMaxDistance(),checker_replanning_,metrics);
+    tree->addBranch(connections);
+  }
+  path->setTree(tree);
+
+  return path;
+}
+
+PathPtr ReplannerManagerBase::optimizePathAhead(const double& max_time)
+{
+  /* Random shortcutting of the path from configuration_replan_ to the goal, then (optionally) PathLocalOptimizer with
+   * the remaining time. The result starts from configuration_replan_, as the replanned paths do, and is returned only
+   * if it improves the cost by at least path_optimizer_min_impr_, otherwise nullptr. It is spliced into the current path,
+   * keeping its goal node and the nodes not removed by the shortcuts */
+  ros::WallTime tic = ros::WallTime::now();
+
+  if(current_path_->getCostFromConf(configuration_replan_) == std::numeric_limits<double>::infinity())
+    return nullptr;
+
+  std::vector<ConnectionPtr> path_connections = current_path_->getConnections();
+
+  int idx;
+  current_path_->curvilinearAbscissaOfPoint(configuration_replan_,idx);
+
+  std::vector<Eigen::VectorXd> waypoints(1,configuration_replan_);
+  std::vector<NodePtr> nodes(1,nullptr);
+  for(unsigned int k=std::max(idx,0);k<path_connections.size();k++)
+  {
+    const NodePtr& node = path_connections[k]->getChild();
+    if((node->getConfiguration()-configuration_replan_).norm()<TOLERANCE)
+      continue;
+
+    waypoints.push_back(node->getConfiguration());
+    nodes.push_back(node);
+  }
+
+  if(waypoints.size()<3)
+    return nullptr;
+
+  MetricsPtr metrics = solver_->getMetrics();
+
+  //Old and new costs are both computed with the metrics, the stored costs of the path may differ from them
+  std::vector<double> costs(waypoints.size()-1);
+  for(unsigned int k=0;k<costs.size();k++)
+    costs[k] = metrics->cost(waypoints[k],waypoints[k+1]);
+
+  double old_cost = std::accumulate(costs.begin(),costs.end(),0.0);
+
+  /* Each pair of waypoints is tried at most once until a shortcut changes the waypoints. Shortcutting stops when all the
+   * pairs have been tried or after PATH_OPTIMIZER_MAX_FAILURES consecutive failures, leaving the cores to the other threads */
+  bool shortcut = false;
+  unsigned int i,j,n_failures = 0;
+  double direct_cost,subpath_cost;
+  std::uniform_int_distribution<unsigned int> ud;
+  std::set<std::pair<unsigned int,unsigned int>> tried;
+
+  while(waypoints.size()>2 && n_failures<PATH_OPTIMIZER_MAX_FAILURES && (ros::WallTime::now()-tic).toSec()<0.5*max_time)
+  {
+    if(tried.size() == (waypoints.size()-1)*(waypoints.size()-2)/2) //pairs of non-consecutive waypoints
+      break;
+
+    i = ud(optimizer_gen_)%(waypoints.size()-2);
+    j = i+2+ud(optimizer_gen_)%(waypoints.size()-i-2);
+
+    if(not tried.insert(std::make_pair(i,j)).second) //already tried, counted as a failure so that the draws are bounded too
+    {
+      n_failures++;
+      continue;
+    }
+
+    subpath_cost = std::accumulate(costs.begin()+i,costs.begin()+j,0.0);
+    direct_cost = metrics->cost(waypoints[i],waypoints[j]);
+
+    if(direct_cost>=subpath_cost-1e-06 || (not checker_replanning_->checkPath(waypoints[i],waypoints[j])))
+    {
+      n_failures++;
+      continue;
+    }
+
+    waypoints.erase(waypoints.begin()+i+1,waypoints.begin()+j);
+    nodes.erase(nodes.begin()+i+1,nodes.begin()+j);
+    costs.erase(costs.begin()+i+1,costs.begin()+j);
+    costs[i] = direct_cost;
+    shortcut = true;
+
+    tried.clear();
+    n_failures = 0;
+  }
+
+  if((not shortcut) && (not path_local_optimizer_))
+    return nullptr;
+
+  double new_cost = std::accumulate(costs.begin(),costs.end(),0.0);
+
+  double remaining_time = max_time-(ros::WallTime::now()-tic).toSec();
+  if(path_local_optimizer_ && remaining_time>0.0)
+  {
+    //The optimizer moves the nodes, so it works on a copy of the waypoints
+    std::vector<ConnectionPtr> connections;
+    NodePtr parent = makeNode(waypoints.front());
+    for(unsigned int k=1;k<waypoints.size();k++)
+    {
+      NodePtr child = makeNode(waypoints[k]);
+      ConnectionPtr conn = makeConnection(parent,child);
+      conn->setCost(costs[k-1]);
+      conn->add();
+
+      connections.push_back(conn);
+      parent = child;
+    }
+
+    PathPtr optimized_path = std::make_shared<Path>(connections,metrics,checker_replanning_);
+    path_local_optimizer_->setPath(optimized_path);
+    path_local_optimizer_->solve(optimized_path,100,remaining_time);
+
+    if(optimized_path->cost()<new_cost)
+    {
+      //Configurations not moved by the optimizer keep their node of the current path, the goal is never moved
+      std::vector<Eigen::VectorXd> optimized_waypoints = optimized_path->getWaypoints();
+      std::vector<NodePtr> optimized_nodes(optimized_waypoints.size(),nullptr);
+
+      unsigned int next = 1;
+      for(unsigned int k=1;k+1<optimized_waypoints.size();k++)
+      {
+        for(unsigned int m=next;m+1<nodes.size();m++)
+        {
+          if(nodes[m] && (nodes[m]->getConfiguration()-optimized_waypoints[k]).norm()<TOLERANCE)
+          {
+            optimized_nodes[k] = nodes[m];
+            next = m+1;
+            break;
+          }
+        }
+      }
+      optimized_nodes.back() = nodes.back();
+
+      waypoints = optimized_waypoints;
+      nodes = optimized_nodes;
+      new_cost = optimized_path->cost();
+    }
+  }
+
+  if(new_cost>(1-path_optimizer_min_impr_)*old_cost)
+    return nullptr;
+
+  return spliceIntoCurrentPath(waypoints,nodes);
+}
+
 bool ReplannerManagerBase::joinThreads()
 {
   if(trj_exec_thread_                         .joinable()) trj_exec_thread_  .join();
@@ -671,6 +1504,7 @@ bool ReplannerManagerBase::joinThreads()
 bool ReplannerManagerBase::stop()
 {
   stop_ = true ;
+  notifySceneUpdate();
   return joinThreads();
 }
 
@@ -687,15 +1521,27 @@ bool ReplannerManagerBase::run()
   ROS_BOLDWHITE_STREAM("Launching threads..");
 
   display_thread_         = std::thread(&ReplannerManagerBase::displayThread            ,this);  //it must be the first one launched, otherwise the first paths will be not displayed in time
+  pinThread(display_thread_,"display");
   if(spawn_objs_)
+  {
     spawn_obj_thread_     = std::thread(&ReplannerManagerBase::spawnObjectsThread       ,this);
+    pinThread(spawn_obj_thread_,"spawn_objects");
+  }
   if(benchmark_)
+  {
     benchmark_thread_     = std::thread(&ReplannerManagerBase::benchmarkThread          ,this);
+    pinThread(benchmark_thread_,"benchmark");
+  }
   if(replanning_enabled_)
+  {
     replanning_thread_    = std::thread(&ReplannerManagerBase::replanningThread         ,this);
+    pinThread(replanning_thread_,"replanning");
+  }
   col_check_thread_       = std::thread(&ReplannerManagerBase::collisionCheckThread     ,this);
+  pinThread(col_check_thread_,"collision_check");
   ros::Duration(0.1).sleep();
   trj_exec_thread_        = std::thread(&ReplannerManagerBase::trajectoryExecutionThread,this);
+  pinThread(trj_exec_thread_,"trajectory_execution");
 
   return true;
 }
@@ -719,16 +1565,41 @@ double ReplannerManagerBase::readScalingTopics()
 
 void ReplannerManagerBase::trajectoryExecutionThread()
 {
-  double  duration;
+  double  duration, goal_distance;
   ros::WallTime tic,toc;
-  PathPtr path2project_on;
+  PathIndexConstPtr path_index;
+  int conn_hint = 0;
   Eigen::VectorXd point2project(pnt_.positions.size());
   Eigen::VectorXd goal_conf = replanner_->getGoal()->getConfiguration();
 
-  ros::WallRate lp(trj_exec_thread_frequency_);
+  /* Real-time mode: SCHED_FIFO and locked memory. In both modes the loop sleeps until absolute deadlines on CLOCK_MONOTONIC,
+   * the same ones jitter and overruns are measured against */
+  if(real_time_enabled_)
+  {
+    if(real_time_lock_memory_)
+      lockMemory();
+
+    if(not setRealTimePriority(real_time_priority_))
+      ROS_ERROR("trajectory execution thread: SCHED_FIFO not available, running with the default scheduler");
+  }
+
+  LoopTimingStatisticsPtr timing_stats = nullptr;
+  if(timing_stats_period_>0.0)
+    timing_stats = std::make_shared<LoopTimingStatistics>(timing_stats_n_bins_,timing_stats_bin_width_);
+
+  bool overrun;
+  double jitter;
+  timespec deadline, now, stats_start;
+  long period_ns = static_cast<long>(1.0e09/trj_exec_thread_frequency_);
+
+  clock_gettime(CLOCK_MONOTONIC,&deadline);
+  stats_start = deadline;
 
   while((not stop_) && ros::ok())
   {
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    jitter = timespecDiff(now,deadline);
+
     tic = ros::WallTime::now();
 
     trj_mtx_.lock();
@@ -738,6 +1609,9 @@ void ReplannerManagerBase::trajectoryExecutionThread()
     if(read_safe_scaling_)
       scaling_ = scaling_*readScalingTopics();
 
+    if(fallback_hold_)
+      scaling_ = 0.0;
+
     real_time_ += dt_;
     t_+= scaling_*dt_;
     t_replan_ = t_+time_shift_*scaling_;
@@ -745,21 +1619,25 @@ void ReplannerManagerBase::trajectoryExecutionThread()
     interpolator_.interpolate(ros::Duration(t_),pnt_         ,scaling_           );
     interpolator_.interpolate(ros::Duration(t_),pnt_unscaled_,scaling_from_param_);
 
-    for(unsigned int i=0; i<pnt_.positions.size();i++)
-      point2project[i] = pnt_.positions[i];
+    goal_distance = pointFromPositions(pnt_.positions,goal_conf,point2project);
 
-    paths_mtx_.lock();
-    path2project_on = current_path_shared_->clone();
-    paths_mtx_.unlock();
+    /* Take the new snapshot only when the path has been changed by the replanning thread. Never wait for paths_mtx_,
+     * if it is busy the snapshot is taken at the next cycle */
+    if(trj_exec_path_sync_needed_ && paths_mtx_.try_lock())
+    {
+      path_index = current_path_snapshot_->getIndex();
+      trj_exec_path_sync_needed_ = false;
+      paths_mtx_.unlock();
 
-    if(path2project_on->findConnection(current_configuration_) != nullptr)
-      current_configuration_ = path2project_on->projectOnPath(point2project,current_configuration_);
-    else
-      current_configuration_ = path2project_on->projectOnPath(point2project);
+      conn_hint = 0;
+    }
+
+    conn_hint = path_index->findConnection(current_configuration_,conn_hint); //-1 if not on the path, then the projection is on the whole path
+    path_index->projectOnPath(point2project,current_configuration_,conn_hint,conn_hint);
 
     trj_mtx_.unlock();
 
-    if((point2project-goal_conf).norm()<goal_tol_)
+    if(goal_distance<goal_tol_)
     {
       stop_ = true;
       goal_reached_ = true;
@@ -781,7 +1659,28 @@ void ReplannerManagerBase::trajectoryExecutionThread()
     if(duration>(1/trj_exec_thread_frequency_) && display_timing_warning_)
       ROS_BOLDYELLOW_STREAM("Trj execution thread time expired: duration-> "<<duration);
 
-    lp.sleep();
+    /* Next deadline, if it has already been missed restart from now instead of running a burst of late cycles */
+    addNanoseconds(deadline,period_ns);
+    clock_gettime(CLOCK_MONOTONIC,&now);
+
+    overrun = (timespecDiff(now,deadline)>0.0);
+    if(overrun)
+      deadline = now;
+
+    if(timing_stats)
+    {
+      timing_stats->addCycle(jitter,duration,overrun);
+
+      if(timespecDiff(now,stats_start)>=timing_stats_period_)
+      {
+        trj_exec_timing_pub_.publish(timing_stats->toMsg());
+        timing_stats->reset();
+        stats_start = now;
+      }
+    }
+
+    while(clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&deadline,nullptr) == EINTR)
+      continue;
   }
 
   stop_ = true;
@@ -825,9 +1724,7 @@ void ReplannerManagerBase::displayThread()
 
   while((not stop_) && ros::ok())
   {
-    paths_mtx_.lock();
-    current_path = current_path_shared_->clone();
-    paths_mtx_.unlock();
+    current_path = getPathSnapshot()->getPath();
 
     replanner_mtx_.lock();
     trj_mtx_.lock();
@@ -895,15 +1792,15 @@ void ReplannerManagerBase::spawnObjectsThread()
   CollisionCheckerPtr checker = checker_cc_->clone();
   planning_scene::PlanningScenePtr planning_scene = planning_scene::PlanningScene::clone(planning_scn_cc_);
 
-  MoveitUtils moveit_utils(planning_scene,group_name_);
   std::string last_link = planning_scene->getRobotModel()->getJointModelGroup(group_name_)->getLinkModelNames().back();
+  KinematicChain chain(planning_scene,group_name_,last_link);
 
   PathPtr current_path;
   Eigen::VectorXd obj_conf, replan_conf;
   Eigen::VectorXd goal_conf = current_path_shared_->getGoalNode()->getConfiguration();
 
   Eigen::Vector3d replan_pose, obj_pose;
-  Eigen::Vector3d goal_pose = forwardIk(goal_conf,last_link,moveit_utils);
+  Eigen::Vector3d goal_pose = chain.position(goal_conf);
 
   std::vector<std::string> ids;
   std::vector<double> moving_time;
@@ -947,16 +1844,16 @@ void ReplannerManagerBase::spawnObjectsThread()
         replanner_mtx_.lock();
         paths_mtx_.lock();
 
-        current_path = current_path_shared_->clone();
+        current_path = current_path_snapshot_->getPath();
         replan_conf = configuration_replan_;
 
         paths_mtx_.unlock();
         replanner_mtx_.unlock();
 
-        current_path->setChecker(checker);
         current_path = current_path->getSubpathFromConf(replan_conf,true);
+        current_path->setChecker(checker);
 
-        replan_pose = forwardIk(replan_conf,last_link,moveit_utils);
+        replan_pose = chain.position(replan_conf);
 
         double obj_abscissa = 0.0;
         while(not stop_ && ros::ok())
@@ -964,7 +1861,7 @@ void ReplannerManagerBase::spawnObjectsThread()
           obj_abscissa = random_abs(gen); //0.2~0.8
 
           obj_conf = current_path->pointOnCurvilinearAbscissa(obj_abscissa);
-          obj_pose = forwardIk(obj_conf,last_link,moveit_utils);
+          obj_pose = chain.position(obj_conf);
 
           // to no collide with the robot or the goal
           if((obj_pose-replan_pose).norm()>obj_max_size_ && (obj_conf-replan_conf).norm()>obj_max_size_ &&
@@ -1107,8 +2004,7 @@ void ReplannerManagerBase::benchmarkThread()
 {
   bool success = true;
   double path_length = 0.0;
-  PathPtr current_path;
-  ConnectionPtr current_conn;
+  PathSnapshotPtr snapshot;
   std::vector<std::string> obj_ids;
   std::vector<Eigen::VectorXd> obj_pos;
   std::vector<std::string>::iterator it;
@@ -1119,8 +2015,8 @@ void ReplannerManagerBase::benchmarkThread()
 
   planning_scene::PlanningScenePtr planning_scene = planning_scene::PlanningScene::clone(planning_scn_cc_);
 
-  MoveitUtils moveit_utils(planning_scene,group_name_);
   std::string last_link = planning_scene->getRobotModel()->getJointModelGroup(group_name_)->getLinkModelNames().back();
+  KinematicChain chain(planning_scene,group_name_,last_link);
   CollisionCheckerPtr checker = std::make_shared<MoveitCollisionChecker>(planning_scene,group_name_);
 
   paths_mtx_.lock();
@@ -1129,7 +2025,7 @@ void ReplannerManagerBase::benchmarkThread()
   double initial_path_length = current_path_shared_->computeEuclideanNorm();
   paths_mtx_.unlock();
 
-  Eigen::VectorXd goal_3d = forwardIk(goal,last_link,moveit_utils);
+  Eigen::VectorXd goal_3d = chain.position(goal);
 
   pnt_conf = start;
   current_configuration = start;
@@ -1185,12 +2081,12 @@ void ReplannerManagerBase::benchmarkThread()
     trj_mtx_.lock();
     paths_mtx_.lock();
     pnt = pnt_;
-    current_path = current_path_shared_->clone();
+    snapshot = current_path_snapshot_;
     current_configuration = current_configuration_;
     paths_mtx_.unlock();
     trj_mtx_.unlock();
 
-    current_configuration_3d = forwardIk(current_configuration,last_link,moveit_utils);
+    current_configuration_3d = chain.position(current_configuration);
 
     for(unsigned int i=0; i<pnt.positions.size();i++)
       pnt_conf(i) = pnt.positions[i];
@@ -1232,9 +2128,9 @@ void ReplannerManagerBase::benchmarkThread()
 
           if(not checker->check(current_configuration)) //Did replanner know about this obstacle? If check(current_configuration) is false, replanner knew the obstacle
           {
-            current_conn = current_path->findConnection(current_configuration);
+            int conn_idx = snapshot->getIndex()->findConnection(current_configuration);
 
-            if(current_conn && (current_conn->getCost() != std::numeric_limits<double>::infinity()))
+            if(conn_idx>=0 && (sharedConnectionCost(snapshot,conn_idx) != std::numeric_limits<double>::infinity()))
               throw std::runtime_error("current conn cost should be infinite! ");
 
             n_collisions++;
@@ -1345,26 +2241,16 @@ void ReplannerManagerBase::benchmarkThread()
 
 Eigen::Vector3d ReplannerManagerBase::forwardIk(const Eigen::VectorXd& conf, const std::string& last_link, const MoveitUtils& util)
 {
-  geometry_msgs::Pose pose;
-  return forwardIk(conf,last_link,util,pose);
+  return util.forwardKinematics(conf,last_link).translation();
 }
 
 
 Eigen::Vector3d ReplannerManagerBase::forwardIk(const Eigen::VectorXd& conf, const std::string& last_link, const MoveitUtils& util,geometry_msgs::Pose& pose)
 {
-  moveit::core::RobotState state = util.fromWaypoints2State(conf);
-  tf::poseEigenToMsg(state.getGlobalLinkTransform(last_link),pose);
-
-  std::vector<double> v(3);
-  v[0] = pose.position.x;
-  v[1] = pose.position.y;
-  v[2] = pose.position.z;
+  Eigen::Isometry3d transform = util.forwardKinematics(conf,last_link);
+  tf::poseEigenToMsg(transform,pose);
 
-  Eigen::Vector3d position(v.size());
-  for(unsigned int i=0;i<v.size();i++)
-    position[i] = v[i];
-
-  return position;
+  return transform.translation();
 }
 
 PathPtr ReplannerManagerBase::trjPath(const PathPtr& path)
@@ -1374,22 +2260,19 @@ PathPtr ReplannerManagerBase::trjPath(const PathPtr& path)
 
   bool conns_changed = false;
   std::vector<ConnectionPtr> conns = trj_path->getConnections();
-  while(conns[0]->norm()<0.05)
+  while(conns.size()>1 && conns[0]->norm()<0.05) //a single short connection is left as it is
   {
-    if(conns.size()>1)
-    {
-      conns[0]->remove();
-      conns[1]->remove();
+    conns[0]->remove();
+    conns[1]->remove();
 
-      ConnectionPtr new_conn = std::make_shared<Connection>(conns[0]->getParent(),conns[1]->getChild());
-      new_conn->setCost(solver_->getMetrics()->cost(conns[0]->getParent()->getConfiguration(),conns[1]->getChild()->getConfiguration()));
-      new_conn->add();
+    ConnectionPtr new_conn = makeConnection(conns[0]->getParent(),conns[1]->getChild());
+    new_conn->setCost(solver_->getMetrics()->cost(conns[0]->getParent()->getConfiguration(),conns[1]->getChild()->getConfiguration()));
+    new_conn->add();
 
-      conns[1] = new_conn;
+    conns[1] = new_conn;
 
-      conns.erase(conns.begin());
-      conns_changed = true;
-    }
+    conns.erase(conns.begin());
+    conns_changed = true;
   }
 
   if(conns_changed)
@@ -1428,7 +2311,7 @@ void ReplannerManagerBase::displayTrj(const DisplayPtr& disp)
     for(unsigned int i=0; i<pnt.positions.size();i++)
       conf(i) = pnt.positions.at(i);
 
-    node = std::make_shared<Node>(conf);
+    node = makeNode(conf);
     nodes.push_back(node);
 
     t+=0.001;
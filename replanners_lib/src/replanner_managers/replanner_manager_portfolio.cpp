@@ -0,0 +1,392 @@
+#include "replanners_lib/replanner_managers/replanner_manager_portfolio.h"
+
+namespace pathplan
+{
+
+ReplannerManagerPortfolio::ReplannerManagerPortfolio(const PathPtr &current_path,
+                                                     const TreeSolverPtr &solver,
+                                                     const ros::NodeHandle &nh):ReplannerManagerBase(current_path,solver,nh)
+{
+  portfolioAdditionalParams();
+
+  portfolio_stats_pub_ = nh_.advertise<std_msgs::Float64MultiArray>(portfolio_stats_topic_,1);
+}
+
+void ReplannerManagerPortfolio::portfolioAdditionalParams()
+{
+  std::vector<std::string> names;
+  if(!nh_.getParam("portfolio/replanners",names))
+  {
+    ROS_ERROR("portfolio/replanners not set, set [MARS, MPRRT]");
+    names = {"MARS","MPRRT"};
+  }
+
+  replanners_names_.clear();
+  replan_only_if_obstructed_ = true;
+  for(const std::string& name:names)
+  {
+    if(name != "MARS" && name != "MPRRT" && name != "DRRT" && name != "DRRTStar" && name != "DRRT*")
+    {
+      ROS_ERROR("Replanner %s can not be used in the portfolio (available: MARS, MPRRT, DRRT, DRRTStar)",name.c_str());
+      continue;
+    }
+
+    if(name == "MARS" || name == "MPRRT")  //they replan also when the path is free, looking for a better one
+      replan_only_if_obstructed_ = false;
+
+    replanners_names_.push_back(name);
+  }
+
+  if(replanners_names_.empty())
+    throw std::invalid_argument("no valid replanners in portfolio/replanners");
+
+  std::string policy;
+  if(!nh_.getParam("portfolio/policy",policy))
+  {
+    ROS_ERROR("portfolio/policy not set, set best");
+    policy = "best";
+  }
+
+  if(policy != "best" && policy != "first")
+  {
+    ROS_ERROR("portfolio/policy should be best or first, set best");
+    policy = "best";
+  }
+  first_solution_ = (policy == "first");
+
+  if(!nh_.getParam("portfolio/stats_topic",portfolio_stats_topic_))
+    portfolio_stats_topic_ = "/replanner_portfolio_stats";
+
+  if(!nh_.getParam("MPRRT/n_threads_replan",n_threads_replan_))
+  {
+    n_threads_replan_ = 5;
+  }
+  else
+  {
+    if(n_threads_replan_<1)
+    {
+      ROS_ERROR("n_threads_replan can not be less than 1, set 1");
+      n_threads_replan_ = 1;
+    }
+  }
+
+  if(!nh_.getParam("MPRRT/shared_tree",shared_tree_))
+    shared_tree_ = false;
+
+  if(!nh_.getParam("MPRRT/shared_tree_capacity",shared_tree_capacity_) || shared_tree_capacity_<1)
+    shared_tree_capacity_ = SHARED_TREE_CAPACITY;
+
+  if(!nh_.getParam("MPRRT/tree_reuse",tree_reuse_))
+    tree_reuse_ = false;
+
+  if(!nh_.getParam("MPRRT/max_reused_tree_nodes",max_reused_tree_nodes_) || max_reused_tree_nodes_<1)
+    max_reused_tree_nodes_ = MAX_REUSED_TREE_NODES;
+
+  if(!nh_.getParam("DRRT/regrow_batch_size",regrow_batch_size_) || regrow_batch_size_<1)
+    regrow_batch_size_ = 1;
+
+  if(!nh_.getParam("DRRT/orphan_bias",orphan_bias_) || orphan_bias_<0.0 || orphan_bias_>1.0)
+    orphan_bias_ = 0.0;
+
+  if(!nh_.getParam("DRRTStar/rewire_n_threads",rewire_n_threads_) || rewire_n_threads_<1)
+    rewire_n_threads_ = 1;
+
+  if(!nh_.getParam("MARS/full_net_search",full_net_search_))
+    full_net_search_ = true;
+}
+
+void ReplannerManagerPortfolio::splitCoreBudget()
+{
+  ReplannerManagerBase::splitCoreBudget();
+
+  if(core_budget_>0) //each replanner clones the replanning checker (MPRRT, DRRT and DRRT* once per parallel worker)
+  {
+    int n_clones = 0;
+    for(const std::string& name:replanners_names_)
+    {
+      if(name == "MPRRT")
+        n_clones += n_threads_replan_;
+      else if(name == "DRRT")
+        n_clones += regrow_batch_size_;
+      else if(name == "DRRTStar" || name == "DRRT*")
+        n_clones += rewire_n_threads_;
+      else
+        n_clones++;
+    }
+
+    n_replanning_checkers_ = n_clones;
+    checker_replanning_n_threads_ = std::max(1,checker_replanning_n_threads_/n_clones);
+  }
+}
+
+bool ReplannerManagerPortfolio::haveToReplan(const bool path_obstructed)
+{
+  if(replan_only_if_obstructed_)
+    return replanIfObstructed(path_obstructed);
+  else
+    return alwaysReplan();
+}
+
+PathPtr ReplannerManagerPortfolio::isolatedPath(const PathPtr& path, const CollisionCheckerPtr& checker)
+{
+  /* Copy of the path, with its own tree, so that the replanners can modify it concurrently */
+  PathPtr path_copy = path->clone();
+  path_copy->setChecker(checker);
+
+  std::vector<ConnectionPtr> connections = path_copy->getConnections();
+  TreePtr tree = std::make_shared<Tree>(connections.front()->getParent(),solver_->getMaxDistance(),checker,solver_->getMetrics());
+  tree->addBranch(connections);
+  path_copy->setTree(tree);
+
+  return path_copy;
+}
+
+ReplannerBasePtr ReplannerManagerPortfolio::createReplanner(const std::string& name, PathPtr path, const TreeSolverPtr& solver)
+{
+  double time_for_repl = 0.9*dt_replan_;
+
+  if(name == "MARS")
+  {
+    MARSPtr replanner = std::make_shared<pathplan::MARS>(configuration_replan_,path,time_for_repl,solver);
+    replanner->setFullNetSearch(full_net_search_);
+    return replanner;
+  }
+  else if(name == "MPRRT")
+  {
+    MPRRTPtr replanner = std::make_shared<pathplan::MPRRT>(configuration_replan_,path,time_for_repl,solver,n_threads_replan_);
+    replanner->setSharedTree(shared_tree_,solver->getMaxDistance(),shared_tree_capacity_);
+    replanner->setTreeReuse(tree_reuse_,max_reused_tree_nodes_);
+    return replanner;
+  }
+  else if(name == "DRRT")
+  {
+    DynamicRRTPtr replanner = std::make_shared<pathplan::DynamicRRT>(configuration_replan_,path,time_for_repl,solver);
+    replanner->setRegrowBatchSize(regrow_batch_size_);
+    replanner->setOrphanBias(orphan_bias_);
+    return replanner;
+  }
+  else if(name == "DRRTStar" || name == "DRRT*")
+  {
+    DynamicRRTStarPtr replanner = std::make_shared<pathplan::DynamicRRTStar>(configuration_replan_,path,time_for_repl,solver);
+    replanner->setRewireThreads(rewire_n_threads_);
+    return replanner;
+  }
+  else
+    throw std::invalid_argument("replanner "+name+" not available in the portfolio");
+}
+
+void ReplannerManagerPortfolio::initReplanner()
+{
+  Eigen::VectorXd lb = solver_->getSampler()->getLB();
+  Eigen::VectorXd ub = solver_->getSampler()->getUB();
+
+  members_.clear();
+  for(const std::string& name:replanners_names_)
+  {
+    PortfolioMember member;
+    member.name = name;
+    member.rebuild = (name == "DRRT" || name == "DRRTStar" || name == "DRRT*");
+    member.checker = checker_replanning_->clone();
+
+    SamplerPtr sampler = std::make_shared<InformedSampler>(lb,ub,lb,ub);
+    member.solver = solver_->clone(solver_->getMetrics()->clone(),member.checker,sampler);
+
+    member.replanner = createReplanner(name,isolatedPath(current_path_,member.checker),member.solver);
+    members_.push_back(member);
+  }
+
+  pending_.clear();
+  pending_.resize(members_.size());
+
+  replanner_ = members_.front().replanner;
+}
+
+bool ReplannerManagerPortfolio::collectPending(const unsigned int& idx, const bool& wait)
+{
+  /* Latency of a run abandoned in a previous cycle, false if it is still running */
+  std::future<double>& f = pending_[idx];
+  if(not f.valid())
+    return true;
+
+  if(not wait && f.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    return false;
+
+  members_[idx].time += f.get();
+  members_[idx].timed++;
+
+  return true;
+}
+
+bool ReplannerManagerPortfolio::replan()
+{
+  /* The replanners abandoned in the previous cycles have been asked to stop, those not returned yet still use their
+   * copies and sit this cycle out */
+  std::vector<bool> racing(members_.size());
+  for(unsigned int i=0;i<members_.size();i++)
+    racing[i] = collectPending(i,false);
+
+  unsigned long world_version = replanner_->getWorldVersion();
+
+  moveit_msgs::PlanningScene scene_msg;
+  checker_replanning_->getPlanningScene()->getPlanningSceneMsg(scene_msg);
+
+  for(unsigned int i=0;i<members_.size();i++)
+  {
+    if(not racing[i])
+      continue;
+
+    PortfolioMember& member = members_[i];
+    member.checker->setPlanningSceneMsg(scene_msg);
+
+    PathPtr path = isolatedPath(current_path_,member.checker);
+    if(member.rebuild)
+      member.replanner = createReplanner(member.name,path,member.solver);
+    else
+      member.replanner->setCurrentPath(path);
+
+    member.replanner->setChecker(member.checker);
+    member.replanner->setMaxTime(replanner_max_time_);
+    member.replanner->setCurrentConf(configuration_replan_);
+    member.replanner->setWorldVersion(world_version);
+    member.replanner->setVerbosity(replanner_verbosity_);
+    member.replanner->setSampleReservoir(sample_reservoir_);
+    member.replanner->setFreeConfigurationReservoir(free_reservoir_,free_reservoir_bias_);
+    member.replanner->resetStop();
+  }
+
+  /* Race, until the replanning time is over */
+  ros::WallTime tic = ros::WallTime::now();
+  ros::WallTime deadline = tic+ros::WallDuration(replanner_max_time_);
+
+  std::vector<std::future<double>> futures(members_.size());
+  unsigned int n_running = 0;
+  for(unsigned int i=0;i<members_.size();i++)
+  {
+    if(not racing[i])
+      continue;
+
+    ReplannerBasePtr replanner = members_[i].replanner;
+    futures[i] = std::async(std::launch::async,[replanner,tic]() -> double {
+      replanner->replan();
+      return (ros::WallTime::now()-tic).toSec(); //latency, also of the runs abandoned at the end of the race
+    });
+    members_[i].runs++;
+    n_running++;
+  }
+
+  int winner = -1;
+  double cost, best_cost = std::numeric_limits<double>::infinity();
+
+  while(n_running>0 && not (first_solution_ && winner>=0) && ros::WallTime::now()<deadline)
+  {
+    for(unsigned int i=0;i<members_.size();i++)
+    {
+      if(not futures[i].valid() || futures[i].wait_for(std::chrono::milliseconds(1)) != std::future_status::ready)
+        continue;
+
+      PortfolioMember& member = members_[i];
+      member.time += futures[i].get();
+      member.timed++;
+      n_running--;
+
+      if(member.replanner->getSuccess())
+      {
+        member.successes++;
+
+        cost = member.replanner->getReplannedPath()->cost();
+        if(cost<best_cost)
+        {
+          best_cost = cost;
+          winner = i;
+        }
+      }
+    }
+  }
+
+  /* Stop the replanners still running; they are collected in the next cycles, never waited for */
+  for(unsigned int i=0;i<members_.size();i++)
+  {
+    if(futures[i].valid())
+    {
+      members_[i].replanner->requestStop();
+      members_[i].abandoned++;
+      pending_[i] = std::move(futures[i]);
+    }
+  }
+
+  ReplannerBasePtr result;
+  if(winner>=0)
+  {
+    members_[winner].wins++;
+    result = members_[winner].replanner;
+
+    /* The path is handed to the other threads of the manager, give it the replanning checker */
+    PathPtr replanned_path = result->getReplannedPath();
+    replanned_path->setChecker(checker_replanning_);
+    if(replanned_path->getTree())
+      replanned_path->getTree()->setChecker(checker_replanning_);
+
+    if(display_replanning_success_)
+      ROS_BOLDWHITE_STREAM("Portfolio: "<<members_[winner].name<<" wins, cost "<<best_cost);
+  }
+  else
+    result = members_.front().replanner; //not successful
+
+  replanner_mtx_.lock();
+  replanner_ = result;
+  replanner_mtx_.unlock();
+
+  publishPortfolioStats();
+
+  return (winner>=0); //the current path is never modified, the replanners work on copies
+}
+
+void ReplannerManagerPortfolio::startReplannedPathFromNewCurrentConf(const Eigen::VectorXd& configuration)
+{
+  joinConfToReplannedPath(configuration);
+}
+
+void ReplannerManagerPortfolio::publishPortfolioStats()
+{
+  /* One row per replanner: runs, successes, wins, abandoned runs, mean replanning time */
+  std_msgs::Float64MultiArray msg;
+
+  std::string names;
+  for(const PortfolioMember& member:members_)
+    names += (names.empty()? "":",")+member.name;
+
+  msg.layout.dim.resize(2);
+  msg.layout.dim[0].label  = names;
+  msg.layout.dim[0].size   = members_.size();
+  msg.layout.dim[0].stride = 5*members_.size();
+  msg.layout.dim[1].label  = "runs,successes,wins,abandoned,mean_time";
+  msg.layout.dim[1].size   = 5;
+  msg.layout.dim[1].stride = 5;
+
+  for(const PortfolioMember& member:members_)
+  {
+    msg.data.push_back(member.runs);
+    msg.data.push_back(member.successes);
+    msg.data.push_back(member.wins);
+    msg.data.push_back(member.abandoned);
+    msg.data.push_back(member.timed>0? member.time/member.timed:0.0);
+  }
+
+  portfolio_stats_pub_.publish(msg);
+}
+
+bool ReplannerManagerPortfolio::joinThreads()
+{
+  ReplannerManagerBase::joinThreads();
+
+  for(unsigned int i=0;i<members_.size();i++)
+    collectPending(i,true);
+
+  ROS_BOLDWHITE_STREAM("Portfolio statistics:");
+  for(const PortfolioMember& member:members_)
+    ROS_BOLDWHITE_STREAM(member.name<<": runs "<<member.runs<<", successes "<<member.successes<<", wins "<<member.wins<<", abandoned "<<member.abandoned<<", mean time "<<(member.timed>0? member.time/member.timed:0.0));
+
+  return true;
+}
+
+}
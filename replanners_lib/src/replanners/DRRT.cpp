@@ -25,6 +25,22 @@ DynamicRRT::DynamicRRT(Eigen::VectorXd& current_configuration,
   solver_ = tmp_solver;
   sampler_ =  std::make_shared<InformedSampler>(lb_,ub_,lb_,ub_);
   tree_is_trimmed_ = false;
+  regrow_batch_size_ = 1;
+  batch_checkers_source_ = nullptr;
+  batch_checkers_world_version_ = 0;
+  batch_pool_ = nullptr;
+
+  orphan_bias_ = 0.0;
+  gen_ = std::mt19937(std::random_device()());
+  ud_ = std::uniform_real_distribution<double>(0.0,1.0);
+  nd_ = std::normal_distribution<double>(0.0,1.0);
+}
+
+void DynamicRRT::setRegrowBatchSize(const unsigned int& batch_size)
+{
+  regrow_batch_size_ = std::max(1u,batch_size);
+  batch_checkers_.clear(); //cloned at the first batch regrow
+  batch_pool_ = nullptr;
 }
 
 void DynamicRRT::fixTree(const NodePtr& node_replan, const NodePtr& root, std::vector<NodePtr>& old_nodes, std::vector<double>& old_connections_costs)
@@ -49,7 +65,7 @@ void DynamicRRT::fixTree(const NodePtr& node_replan, const NodePtr& root, std::v
       {
         for(unsigned int j=i;j<old_nodes.size();j++)
         {
-          ConnectionPtr conn = std::make_shared<Connection>(old_nodes.at(j-1),old_nodes.at(j));
+          ConnectionPtr conn = makeConnection(old_nodes.at(j-1),old_nodes.at(j));
           conn->setCost(old_connections_costs.at(j-1));
           conn->add();
 
@@ -85,7 +101,7 @@ void DynamicRRT::fixTree(const NodePtr& node_replan, const NodePtr& root, std::v
       NodePtr parent = node_replan->getParents().front();
       NodePtr child = node_replan->getChildren().front();
 
-      ConnectionPtr conn = std::make_shared<Connection>(parent,child);
+      ConnectionPtr conn = makeConnection(parent,child);
       double cost = node_replan->parentConnection(0)->getCost()+child->parentConnection(0)->getCost();
       conn->setCost(cost);
       conn->add();
@@ -106,6 +122,7 @@ bool DynamicRRT::trimInvalidTree(NodePtr& node)
 
   bool trimmed = false;
   TreePtr tree= current_path_->getTree();
+  orphan_seeds_.clear();
 
   NodePtr child;
   unsigned int removed_nodes;      //will not be used;
@@ -116,7 +133,7 @@ bool DynamicRRT::trimInvalidTree(NodePtr& node)
   std::vector<ConnectionPtr> node2goal = tree->getConnectionToNode(node); //Note: the root must be the goal (set in regrowRRT())
   for(const ConnectionPtr &conn: node2goal)
   {
-    if((ros::WallTime::now()-tic).toSec()>=max_time_)
+    if((ros::WallTime::now()-tic).toSec()>=max_time_ || stop_)
     {
       if(verbose_)
         ROS_INFO("Time to trim expired");
@@ -145,6 +162,9 @@ bool DynamicRRT::trimInvalidTree(NodePtr& node)
     if(obstructed)
     {
       child = conn->getChild();
+      if(orphan_bias_>0.0)
+        addOrphanSeeds(child);
+
       tree->purgeFromHere(child,white_list,removed_nodes); //remove the successors and the connection from parent to child
 
       trimmed = true;
@@ -155,45 +175,266 @@ bool DynamicRRT::trimInvalidTree(NodePtr& node)
   if(not trimmed)
     return false;
 
-  //Now check the remaining tree
-  bool trimmed_again;
-  do
-  {
-    trimmed_again = false;
+  //Now check the remaining tree: a single top-down visit from the root, each connection is checked at most once
+  //and the subtree below an invalid connection is purged without being visited
+  NodePtr parent;
+  bool expired = false;
+  std::vector<NodePtr> stack;
+  std::vector<ConnectionPtr> child_connections;
+  stack.push_back(tree->getRoot());
 
-    std::vector<NodePtr> leaves;
-    std::vector<ConnectionPtr> path_connections;
-
-    tree->getLeaves(leaves);
-    assert(not leaves.empty());
+  while(not stack.empty())
+  {
+    parent = stack.back();
+    stack.pop_back();
 
-    for(const NodePtr& leave:leaves)
+    child_connections = parent->getChildConnections();
+    for(const ConnectionPtr& conn:child_connections)
     {
-      if(not tree->checkPathToNode(leave,checked_connections_,path_connections))
+      if((ros::WallTime::now()-tic).toSec()>=max_time_ || stop_)
       {
-        for(const ConnectionPtr& conn:path_connections)
+        expired = true;
+        break;
+      }
+
+      obstructed = false;
+      if(not conn->isRecentlyChecked())
+      {
+        if(not checker_->checkConnection(conn))
         {
-          if(conn->getCost() == std::numeric_limits<double>::infinity())
-          {
-            child = conn->getChild();
-            tree->purgeFromHere(child,white_list,removed_nodes);
+          conn->setCost(std::numeric_limits<double>::infinity());
+          obstructed = true;
+        }
+
+        conn->setRecentlyChecked(true);
+        checked_connections_.push_back(conn);
+      }
+      else
+      {
+        if(conn->getCost() == std::numeric_limits<double>::infinity())
+          obstructed = true;
+      }
 
-            trimmed = true;
-            trimmed_again = true;
+      child = conn->getChild();
+      if(obstructed)
+      {
+        if(orphan_bias_>0.0)
+          addOrphanSeeds(child);
 
-            break;
-          }
-        }
-        if(trimmed_again)
-          break;
+        tree->purgeFromHere(child,white_list,removed_nodes);
       }
+      else
+        stack.push_back(child);
     }
-  }while(trimmed_again);
+
+    if(expired)
+    {
+      if(verbose_)
+        ROS_INFO("Time to trim expired, the tree has been partially checked");
+
+      break;
+    }
+  }
 
   trimmed_tree_ = tree;
   return trimmed;
 }
 
+void DynamicRRT::connectReplanNode(const NodePtr& new_node, const NodePtr& node)
+{
+  if(not (node->getParentConnectionsSize() == 0) && not (node->getChildConnectionsSize() == 0))
+  {
+    ROS_INFO_STREAM("node:\n"<<*node);
+    assert(0);
+  }
+
+  ConnectionPtr conn = makeConnection(new_node, node);
+  conn->setCost(metrics_->cost(new_node, node));
+  conn->add();
+
+  conn->setRecentlyChecked(true);
+  checked_connections_.push_back(conn);
+
+  trimmed_tree_->addNode(node);
+
+  //Set the root in the node and extract the new path
+  trimmed_tree_->changeRoot(node);
+  replanned_path_ = std::make_shared<Path>(trimmed_tree_->getConnectionToNode(goal_node_), metrics_, checker_);
+  replanned_path_->setTree(trimmed_tree_);
+
+  // SOLUZIONE MOMENTANEA
+  for(unsigned int i=0;i<replanned_path_->getConnectionsSize();i++)
+  {
+    if(replanned_path_->getConnections().at(i)->norm() <1e-06)
+    {
+      if(replanned_path_->getConnections().at(i)->getParent()->getChildConnectionsSize() == 1)
+      {
+        ConnectionPtr conn = makeConnection(replanned_path_->getConnections().at(i-1)->getParent(),replanned_path_->getConnections().at(i)->getChild());
+        double cost = metrics_->cost(replanned_path_->getConnections().at(i-1)->getParent(),replanned_path_->getConnections().at(i)->getChild());
+        conn->setCost(cost);
+        conn->add();
+
+        replanned_path_->getConnections().at(i)->remove();
+
+        replanned_path_ = std::make_shared<Path>(trimmed_tree_->getConnectionToNode(goal_node_), metrics_, checker_);
+        break;
+      }
+      else if(replanned_path_->getConnections().at(i)->getChild()->getChildConnectionsSize() == 1)
+      {
+        ConnectionPtr conn = makeConnection(replanned_path_->getConnections().at(i)->getParent(),replanned_path_->getConnections().at(i+1)->getChild());
+        double cost = metrics_->cost(replanned_path_->getConnections().at(i)->getParent(),replanned_path_->getConnections().at(i+1)->getChild());
+        conn->setCost(cost);
+        conn->add();
+
+        replanned_path_->getConnections().at(i)->remove();
+
+        replanned_path_ = std::make_shared<Path>(trimmed_tree_->getConnectionToNode(goal_node_), metrics_, checker_);
+        break;
+      }
+    }
+  }
+  // FINO A QUA
+
+  solver_->setStartTree(trimmed_tree_);
+  solver_->setSolution(replanned_path_,true);
+
+  tree_is_trimmed_ = false;
+
+  success_ = true;
+}
+
+void DynamicRRT::regrowBatch(const NodePtr& node, const double& max_distance, const ros::WallTime& tic)
+{
+  /* Batches of regrow_batch_size_ samples: each sample is steered from its closest node of the tree, then the extensions
+   * (and their connection to node, when close enough) are validated in parallel, each worker with its own clone of the
+   * checker. The valid extensions are added to the tree in sample order, so the tree does not depend on the threads timing.
+   * Checkers and workers are kept across batches and regrows, the scene is copied into the checkers only when the
+   * world version or the checker change */
+  unsigned int batch_size = regrow_batch_size_;
+
+  if(batch_checkers_.size() != batch_size || batch_checkers_source_ != checker_)
+  {
+    batch_checkers_.clear();
+    for(unsigned int i=0;i<batch_size;i++)
+      batch_checkers_.push_back(checker_->clone());
+
+    batch_checkers_source_ = checker_;
+    batch_checkers_world_version_ = world_version_;
+  }
+  else if(batch_checkers_world_version_ != world_version_)
+  {
+    moveit_msgs::PlanningScene scene_msg;
+    checker_->getPlanningScene()->getPlanningSceneMsg(scene_msg);
+    for(const CollisionCheckerPtr& checker:batch_checkers_)
+      checker->setPlanningSceneMsg(scene_msg);
+
+    batch_checkers_world_version_ = world_version_;
+  }
+
+  if(batch_pool_ == nullptr || batch_pool_->size() != batch_size-1)
+    batch_pool_ = std::make_shared<WorkerPool>(batch_size-1);
+
+  Eigen::VectorXd sample, closest_conf;
+  Eigen::VectorXd node_conf = node->getConfiguration();
+
+  std::vector<NodePtr> closest_nodes(batch_size);
+  std::vector<Eigen::VectorXd> new_confs(batch_size);
+  std::vector<char> valid(batch_size), connected(batch_size); //written concurrently, one element per task
+
+  double distance;
+  double time = (ros::WallTime::now()-tic).toSec();
+  while(time<max_time_ && not success_ && not stop_)
+  {
+    //The tree is read and modified only by this thread
+    for(unsigned int i=0;i<batch_size;i++)
+    {
+      sample = sampleRegrow(max_distance);
+      closest_nodes[i] = trimmed_tree_->findClosestNode(sample);
+      closest_conf = closest_nodes[i]->getConfiguration();
+
+      distance = (sample-closest_conf).norm();
+      if(distance>max_distance)
+        new_confs[i] = closest_conf+(sample-closest_conf)*(max_distance/distance);
+      else
+        new_confs[i] = sample;
+    }
+
+    batch_pool_->parallelFor(batch_size,[&](const unsigned int& i)->void{
+      const CollisionCheckerPtr& checker = batch_checkers_[i];
+
+      valid[i] = ((new_confs[i]-closest_nodes[i]->getConfiguration()).norm()>TOLERANCE) &&
+          checker->checkPath(closest_nodes[i]->getConfiguration(),new_confs[i]);
+
+      connected[i] = valid[i] && ((new_confs[i]-node_conf).norm()<max_distance) &&
+          checker->checkPath(new_confs[i],node_conf);
+    });
+
+    for(unsigned int i=0;i<batch_size;i++)
+    {
+      if(not valid[i])
+        continue;
+
+      NodePtr new_node = makeNode(new_confs[i]);
+      ConnectionPtr conn = makeConnection(closest_nodes[i],new_node);
+      conn->setCost(metrics_->cost(closest_nodes[i],new_node));
+      conn->add();
+
+      conn->setRecentlyChecked(true);
+      checked_connections_.push_back(conn);
+
+      trimmed_tree_->addNode(new_node,false);
+
+      if(connected[i])
+      {
+        connectReplanNode(new_node,node);
+        break;
+      }
+    }
+
+    time = (ros::WallTime::now()-tic).toSec();
+  }
+}
+
+void DynamicRRT::addOrphanSeeds(const NodePtr& subtree_root)
+{
+  std::vector<NodePtr> stack;
+  stack.push_back(subtree_root);
+
+  NodePtr n;
+  while(not stack.empty())
+  {
+    n = stack.back();
+    stack.pop_back();
+
+    orphan_seeds_.push_back(n->getConfiguration());
+    for(const NodePtr& child:n->getChildren())
+      stack.push_back(child);
+  }
+}
+
+Eigen::VectorXd DynamicRRT::sampleRegrow(const double& max_distance)
+{
+  if(orphan_seeds_.empty() || ud_(gen_)>=orphan_bias_)
+    return sampler_->sample();
+
+  /* Uniform sample in the ball of radius max_distance around a random orphan seed, so that the tree grows towards the
+   * orphaned region and the extensions can be connected to it */
+  const Eigen::VectorXd& seed = orphan_seeds_.at(std::min((size_t)(ud_(gen_)*orphan_seeds_.size()),orphan_seeds_.size()-1));
+
+  Eigen::VectorXd direction(seed.size());
+  for(unsigned int i=0;i<seed.size();i++)
+    direction(i) = nd_(gen_);
+
+  double norm = direction.norm();
+  if(norm<TOLERANCE)
+    return seed;
+
+  double radius = max_distance*std::pow(ud_(gen_),1.0/seed.size());
+  Eigen::VectorXd sample = seed+(radius/norm)*direction;
+
+  return sample.cwiseMax(lb_).cwiseMin(ub_);
+}
+
 bool DynamicRRT::regrowRRT(NodePtr& node)
 {
   ros::WallTime tic = ros::WallTime::now();
@@ -227,87 +468,45 @@ bool DynamicRRT::regrowRRT(NodePtr& node)
   double max_distance = trimmed_tree_->getMaximumDistance();
   assert(max_distance>0.0);
 
-  double time = (ros::WallTime::now()-tic).toSec();
-  while(time<max_time_ && not success_)
+  unsigned int first_regrown = checked_connections_.size();
+
+  if(regrow_batch_size_>1)
+    regrowBatch(node,max_distance,tic);
+  else
   {
-    NodePtr new_node;
-    Eigen::VectorXd conf = sampler_->sample();
-    if(trimmed_tree_->extend(conf,new_node))
+    double time = (ros::WallTime::now()-tic).toSec();
+    while(time<max_time_ && not success_ && not stop_)
     {
-      assert(new_node->getParentConnectionsSize() == 1);
-      new_node->getParentConnections().front()->setRecentlyChecked(true);
-      checked_connections_.push_back(new_node->getParentConnections().front());
-
-      if((new_node->getConfiguration() - node->getConfiguration()).norm() < max_distance)
+      NodePtr new_node;
+      Eigen::VectorXd conf = sampleRegrow(max_distance);
+      if(trimmed_tree_->extend(conf,new_node))
       {
-        if(checker_->checkPath(new_node->getConfiguration(), node->getConfiguration()))
-        {
-          if(not (node->getParentConnectionsSize() == 0) && not (node->getChildConnectionsSize() == 0))
-          {
-            ROS_INFO_STREAM("node:\n"<<*node);
-            assert(0);
-          }
-
-          ConnectionPtr conn = std::make_shared<Connection>(new_node, node);
-          conn->setCost(metrics_->cost(new_node, node));
-          conn->add();
+        assert(new_node->getParentConnectionsSize() == 1);
+        new_node->getParentConnections().front()->setRecentlyChecked(true);
+        checked_connections_.push_back(new_node->getParentConnections().front());
 
-          conn->setRecentlyChecked(true);
-          checked_connections_.push_back(conn);
-
-          trimmed_tree_->addNode(node);
-
-          //Set the root in the node and extract the new path
-          trimmed_tree_->changeRoot(node);
-          replanned_path_ = std::make_shared<Path>(trimmed_tree_->getConnectionToNode(goal_node_), metrics_, checker_);
-          replanned_path_->setTree(trimmed_tree_);
-
-          // SOLUZIONE MOMENTANEA
-          for(unsigned int i=0;i<replanned_path_->getConnectionsSize();i++)
+        if((new_node->getConfiguration() - node->getConfiguration()).norm() < max_distance)
+        {
+          if(checker_->checkPath(new_node->getConfiguration(), node->getConfiguration()))
           {
-            if(replanned_path_->getConnections().at(i)->norm() <1e-06)
-            {
-              if(replanned_path_->getConnections().at(i)->getParent()->getChildConnectionsSize() == 1)
-              {
-                ConnectionPtr conn = std::make_shared<Connection>(replanned_path_->getConnections().at(i-1)->getParent(),replanned_path_->getConnections().at(i)->getChild());
-                double cost = metrics_->cost(replanned_path_->getConnections().at(i-1)->getParent(),replanned_path_->getConnections().at(i)->getChild());
-                conn->setCost(cost);
-                conn->add();
-
-                replanned_path_->getConnections().at(i)->remove();
-
-                replanned_path_ = std::make_shared<Path>(trimmed_tree_->getConnectionToNode(goal_node_), metrics_, checker_);
-                break;
-              }
-              else if(replanned_path_->getConnections().at(i)->getChild()->getChildConnectionsSize() == 1)
-              {
-                ConnectionPtr conn = std::make_shared<Connection>(replanned_path_->getConnections().at(i)->getParent(),replanned_path_->getConnections().at(i+1)->getChild());
-                double cost = metrics_->cost(replanned_path_->getConnections().at(i)->getParent(),replanned_path_->getConnections().at(i+1)->getChild());
-                conn->setCost(cost);
-                conn->add();
-
-                replanned_path_->getConnections().at(i)->remove();
-
-                replanned_path_ = std::make_shared<Path>(trimmed_tree_->getConnectionToNode(goal_node_), metrics_, checker_);
-                break;
-              }
-            }
+            connectReplanNode(new_node,node);
+            break;
           }
-          // FINO A QUA
-
-          solver_->setStartTree(trimmed_tree_);
-          solver_->setSolution(replanned_path_,true);
-
-          tree_is_trimmed_ = false;
-
-          success_ = true;
-          break;
         }
       }
+      time = (ros::WallTime::now()-tic).toSec();
     }
-    time = (ros::WallTime::now()-tic).toSec();
   }
 
+  //The regrown nodes have been validated in the current world
+  std::vector<NodePtr> regrown_nodes;
+  for(unsigned int i=first_regrown;i<checked_connections_.size();i++)
+  {
+    if(checked_connections_[i]->getCost()<std::numeric_limits<double>::infinity())
+      regrown_nodes.push_back(checked_connections_[i]->getChild());
+  }
+  storeFreeConfigurations(regrown_nodes);
+
   return success_;
 }
 bool DynamicRRT::replan()
@@ -21,6 +21,77 @@ DynamicRRTStar::DynamicRRTStar(Eigen::VectorXd& current_configuration,
     tmp_solver = std::static_pointer_cast<RRTStar>(solver);
 
   solver_ = tmp_solver;
+  rewire_n_threads_ = 1;
+  rewire_checkers_source_ = nullptr;
+  rewire_checkers_world_version_ = 0;
+  rewire_pool_ = nullptr;
+
+  region_sampler_ = nullptr;
+  region_rewired_ = false;
+  region_world_version_ = 0;
+}
+
+bool DynamicRRTStar::sameRegion(const TreePtr& tree, const NodePtr& replan_start, const NodePtr& replan_goal)
+{
+  if(region_sampler_ == nullptr)
+    return false;
+
+  return (region_tree_ == tree && region_start_ == replan_start && region_goal_ == replan_goal &&
+          region_world_version_ == world_version_ && tree->isInTree(region_start_) && tree->isInTree(region_goal_));
+}
+
+void DynamicRRTStar::prefetchRewireChecks(const SubtreePtr& subtree, const Eigen::VectorXd& configuration, const double& radius,
+                                          const NodePtr& closest_node, const double& cost2configuration)
+{
+  /* The rewire around configuration checks the extension from the closest node (when configuration is a new node) and the
+   * connections with the neighbours which pass its cost tests: as parent, a neighbour is checked only if it improves the
+   * cost-to-come of configuration (at most the one through the closest node); as child, only if configuration improves its
+   * cost-to-come. Check them concurrently, the rewire will find the results. The cost-to-come of a new node is not known
+   * until its parent is chosen, so its lowest possible value is used for the child test */
+  cached_checker_->clear();
+
+  std::vector<std::pair<Eigen::VectorXd,Eigen::VectorXd>> segments;
+
+  double cost_upper_bound = cost2configuration;
+  double cost_lower_bound = cost2configuration;
+  if(closest_node)
+  {
+    segments.push_back(std::make_pair(closest_node->getConfiguration(),configuration));
+    cost_upper_bound = subtree->costToNode(closest_node)+metrics_->cost(closest_node->getConfiguration(),configuration);
+    cost_lower_bound = cost_upper_bound;
+  }
+
+  NodePtr fake_node = makeNode(configuration);
+  std::multimap<double,NodePtr> near_nodes = subtree->near(fake_node,radius);
+
+  std::vector<NodePtr> neighbours;
+  std::vector<double> neighbours_cost;
+  neighbours.reserve(near_nodes.size());
+  neighbours_cost.reserve(near_nodes.size());
+  for(const std::pair<double,NodePtr>& p:near_nodes)
+  {
+    if(p.second == closest_node || p.second->getConfiguration() == configuration)
+      continue;
+
+    neighbours.push_back(p.second);
+    neighbours_cost.push_back(subtree->costToNode(p.second));
+
+    if(closest_node)
+      cost_lower_bound = std::min(cost_lower_bound,neighbours_cost.back()+metrics_->cost(p.second->getConfiguration(),configuration));
+  }
+
+  for(unsigned int i=0;i<neighbours.size();i++)
+  {
+    const Eigen::VectorXd& neighbour_conf = neighbours[i]->getConfiguration();
+
+    bool parent_candidate = closest_node && (neighbours_cost[i]+metrics_->cost(neighbour_conf,configuration)<cost_upper_bound);
+    bool child_candidate  = (cost_lower_bound+metrics_->cost(configuration,neighbour_conf)<neighbours_cost[i]);
+
+    if(parent_candidate || child_candidate)
+      segments.push_back(std::make_pair(configuration,neighbour_conf));
+  }
+
+  cached_checker_->prefetch(segments,rewire_checkers_,rewire_pool_);
 }
 
 bool DynamicRRTStar::nodeBeforeObs(const PathPtr& subpath, NodePtr& node_before)
@@ -86,10 +157,24 @@ bool DynamicRRTStar::connectBehindObs(const NodePtr& node)
     ROS_INFO_STREAM("Replan start: \n"<< *replan_start);
 
   double radius = 1.1*((replan_goal->getConfiguration()-replan_start->getConfiguration()).norm())/2;
-  Eigen::VectorXd u = (replan_goal->getConfiguration()-replan_start->getConfiguration())/(replan_goal->getConfiguration()-replan_start->getConfiguration()).norm();
-  Eigen::VectorXd ball_center = replan_start->getConfiguration()+u*(((replan_goal->getConfiguration()-replan_start->getConfiguration()).norm())/2);
-  LocalInformedSampler sampler (replan_start->getConfiguration(),replan_goal->getConfiguration(),lb_,ub_,std::numeric_limits<double>::infinity());
-  sampler.addBall(ball_center,radius);
+
+  if(sameRegion(tree,replan_start,replan_goal))
+  {
+    if(verbose_)
+      ROS_INFO("Same replanning region and world of the previous cycle, continue its refinement");
+  }
+  else
+  {
+    Eigen::VectorXd u = (replan_goal->getConfiguration()-replan_start->getConfiguration())/(replan_goal->getConfiguration()-replan_start->getConfiguration()).norm();
+    Eigen::VectorXd ball_center = replan_start->getConfiguration()+u*(((replan_goal->getConfiguration()-replan_start->getConfiguration()).norm())/2);
+    region_sampler_ = makeLocalSampler(replan_start->getConfiguration(),replan_goal->getConfiguration(),ball_center,radius);
+
+    region_tree_ = tree;
+    region_start_ = replan_start;
+    region_goal_ = replan_goal;
+    region_world_version_ = world_version_;
+    region_rewired_ = false;
+  }
 
   //*  STEP 1: REWIRING  *//
   std::vector<ConnectionPtr> checked_connections = current_path_->getConnections();
@@ -111,11 +196,47 @@ bool DynamicRRTStar::connectBehindObs(const NodePtr& node)
     throw std::runtime_error("root can't be changed (replan_start)");
   }
 
+  bool parallel_rewire = (rewire_n_threads_>1);
+  if(parallel_rewire)
+  {
+    if(rewire_checkers_.size() != rewire_n_threads_ || rewire_checkers_source_ != checker_)
+    {
+      rewire_checkers_.clear();
+      for(unsigned int i=0;i<rewire_n_threads_;i++)
+        rewire_checkers_.push_back(checker_->clone());
+
+      rewire_checkers_source_ = checker_;
+      rewire_checkers_world_version_ = world_version_;
+    }
+    else if(rewire_checkers_world_version_ != world_version_)
+    {
+      moveit_msgs::PlanningScene scene_msg;
+      checker_->getPlanningScene()->getPlanningSceneMsg(scene_msg);
+      for(const CollisionCheckerPtr& checker:rewire_checkers_)
+        checker->setPlanningSceneMsg(scene_msg);
+
+      rewire_checkers_world_version_ = world_version_;
+    }
+
+    if(rewire_pool_ == nullptr || rewire_pool_->size() != rewire_n_threads_-1)
+      rewire_pool_ = std::make_shared<WorkerPool>(rewire_n_threads_-1);
+
+    cached_checker_ = std::make_shared<CachedCollisionChecker>(checker_);
+    tree->setChecker(cached_checker_);  //the subtree takes the checker of the tree
+  }
+
   std::vector<NodePtr> black_list;
   black_list.push_back(replan_goal);
   SubtreePtr subtree = Subtree::createSubtree(tree,replan_start,black_list);
 
-  subtree->rewireOnlyWithPathCheck(replan_start,checked_connections,radius,white_list,2); //rewire only children
+  if(not region_rewired_) //already done in a previous cycle for this region
+  {
+    if(parallel_rewire)
+      prefetchRewireChecks(subtree,replan_start->getConfiguration(),radius,nullptr,subtree->costToNode(replan_start));
+
+    subtree->rewireOnlyWithPathCheck(replan_start,checked_connections,radius,white_list,2); //rewire only children
+    region_rewired_ = true;
+  }
 
   //*  STEP 2: ADDING NEW NODES AND SEARCHING WITH RRT*  *//
   if(disp_ && verbose_)
@@ -125,6 +246,7 @@ bool DynamicRRTStar::connectBehindObs(const NodePtr& node)
   double distance_new_node_goal, cost2new_node;
 
   NodePtr new_node;
+  std::vector<NodePtr> new_nodes;
   Eigen::VectorXd q;
 
   double max_distance = tree->getMaximumDistance();
@@ -132,12 +254,25 @@ bool DynamicRRTStar::connectBehindObs(const NodePtr& node)
   double max_time = 0.98*max_time_;
   double time = (ros::WallTime::now()-tic).toSec();
 
-  while(time<0.98*max_time)
+  while(time<0.98*max_time && not stop_)
   {
-    q = sampler.sample();
+    q = region_sampler_->sample();
+
+    if(parallel_rewire)
+    {
+      /* Prefetch the checks of the configuration the tree will steer q to, computed by the tree itself from the same
+       * closest node. The tree still gets q, so the serial and the parallel rewire build the same tree */
+      NodePtr closest_node = subtree->findClosestNode(q);
+      Eigen::VectorXd next_configuration;
+      subtree->selectNextConfiguration(q,next_configuration,closest_node);
+
+      prefetchRewireChecks(subtree,next_configuration,radius,closest_node);
+    }
 
     if(subtree->rewireWithPathCheck(q,checked_connections,radius,white_list,new_node))
     {
+      new_nodes.push_back(new_node);
+
       if(disp_ && verbose_)
         disp_->displayNode(new_node);
 
@@ -160,7 +295,7 @@ bool DynamicRRTStar::connectBehindObs(const NodePtr& node)
           }
 
           double cost = metrics_->cost(new_node->getConfiguration(),replan_goal->getConfiguration());
-          ConnectionPtr conn = std::make_shared<Connection>(new_node,replan_goal);
+          ConnectionPtr conn = makeConnection(new_node,replan_goal);
           conn->setCost(cost);
           conn->add();
 
@@ -180,6 +315,14 @@ bool DynamicRRTStar::connectBehindObs(const NodePtr& node)
   if(disp_ && verbose_)
     disp_->defaultNodeSize();
 
+  storeFreeConfigurations(new_nodes); //validated in the current world
+
+  if(parallel_rewire)
+  {
+    tree->setChecker(checker_);
+    cached_checker_ = nullptr;
+  }
+
   if(not tree->changeRoot(node))
     throw std::runtime_error("root can't be changed");
 
@@ -205,6 +348,8 @@ bool DynamicRRTStar::connectBehindObs(const NodePtr& node)
 
     solver_->setStartTree(tree);
     solver_->setSolution(replanned_path_);
+
+    region_sampler_ = nullptr; //the path has changed, the next obstruction defines a new region
   }
 
   std::for_each(checked_connections.begin(),checked_connections.end(),[&](ConnectionPtr c) {c->setRecentlyChecked(false);});
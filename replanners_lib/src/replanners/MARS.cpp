@@ -28,6 +28,30 @@ MARS::MARS(const Eigen::VectorXd& current_configuration,
   pathSwitch_verbose_ = false;
 
   examined_flag_ = Node::getReservedFlagsNumber(); //the first free position in Node::flags_ vector where we can store our new custom flag
+
+  switch(current_configuration.size())
+  {
+  case 3:  nodes_distance_ = &MARS::nodesDistanceKernel<3> ; break;
+  case 6:  nodes_distance_ = &MARS::nodesDistanceKernel<6> ; break;
+  case 12: nodes_distance_ = &MARS::nodesDistanceKernel<12>; break;
+  case 18: nodes_distance_ = &MARS::nodesDistanceKernel<18>; break;
+  default: nodes_distance_ = &MARS::nodesDistanceKernel<Eigen::Dynamic>;
+  }
+}
+
+template<int DOF>
+void MARS::nodesDistanceKernel(const Eigen::VectorXd& configuration, const std::vector<NodePtr>& nodes, std::vector<double>& distances) const
+{
+  typedef Eigen::Matrix<double,DOF,1> Vector;
+
+  Eigen::Map<const Vector> q(configuration.data(),configuration.size());
+
+  distances.resize(nodes.size());
+  for(unsigned int i=0;i<nodes.size();i++)
+  {
+    const Eigen::VectorXd& node_configuration = nodes[i]->getConfiguration();
+    distances[i] = (Eigen::Map<const Vector>(node_configuration.data(),node_configuration.size())-q).norm();
+  }
 }
 
 MARS::MARS(const Eigen::VectorXd& current_configuration,
@@ -49,9 +73,9 @@ void MARS::copyTreeRoot()
 
   paths_start_ = tree_->getRoot();
   assert(tree_->getRoot() == current_path_->getConnections().front()->getParent());
-  NodePtr new_tree_root =std::make_shared<Node>(paths_start_->getConfiguration());
+  NodePtr new_tree_root =makeNode(paths_start_->getConfiguration());
 
-  ConnectionPtr conn = std::make_shared<Connection>(paths_start_,new_tree_root,false);
+  ConnectionPtr conn = makeConnection(paths_start_,new_tree_root,false);
   conn->setCost(0.0);
   conn->add();
 
@@ -118,7 +142,7 @@ bool MARS::mergePathToTree(const PathPtr &path)
         ConnectionPtr first_conn = current_path_->getConnections().front();
         assert(not first_conn->isNet());
 
-        ConnectionPtr new_first_conn = std::make_shared<Connection>(paths_start_,first_conn->getChild());
+        ConnectionPtr new_first_conn = makeConnection(paths_start_,first_conn->getChild());
         new_first_conn->setCost(first_conn->getCost());
         new_first_conn->add();
 
@@ -170,7 +194,7 @@ bool MARS::mergePathToTree(const PathPtr &path)
           {
             assert(not child_conn->isNet());
 
-            conn = std::make_shared<Connection>(paths_start_,child_conn->getChild());
+            conn = makeConnection(paths_start_,child_conn->getChild());
             conn->setCost(child_conn->getCost());
             conn->add();
           }
@@ -180,7 +204,7 @@ bool MARS::mergePathToTree(const PathPtr &path)
           {
             assert(not parent_conn->isNet());
 
-            conn = std::make_shared<Connection>(parent_conn->getParent(),paths_start_);
+            conn = makeConnection(parent_conn->getParent(),paths_start_);
             conn->setCost(parent_conn->getCost());
             conn->add();
           }
@@ -213,7 +237,7 @@ bool MARS::mergePathToTree(const PathPtr &path)
           ConnectionPtr first_conn = path->getConnections().front();
           assert(not first_conn->isNet());
 
-          ConnectionPtr new_first_conn = std::make_shared<Connection>(paths_start_,first_conn->getChild());
+          ConnectionPtr new_first_conn = makeConnection(paths_start_,first_conn->getChild());
           new_first_conn->setCost(first_conn->getCost());
           new_first_conn->add();
 
@@ -254,8 +278,8 @@ bool MARS::mergePathToTree(const PathPtr &path)
 
   ConnectionPtr new_goal_conn;
   (goal_node_->getParentConnectionsSize() == 0)?
-        (new_goal_conn = std::make_shared<Connection>(goal_conn->getParent(),goal_node_,false)):
-        (new_goal_conn = std::make_shared<Connection>(goal_conn->getParent(),goal_node_,true ));
+        (new_goal_conn = makeConnection(goal_conn->getParent(),goal_node_,false)):
+        (new_goal_conn = makeConnection(goal_conn->getParent(),goal_node_,true ));
 
   new_goal_conn->setCost(goal_conn->getCost());
   new_goal_conn->add();
@@ -366,8 +390,10 @@ std::vector<ps_goal_ptr> MARS::sortNodes(const NodePtr& start_node)
   std::multimap<double,ps_goal_ptr> ps_goals_map, ps_invalid_goals_map;
 
   double euclidean_distance, utopia;
+  std::vector<double> distances;
   bool start_node_belongs_to_p;
   bool goal_node_considered = false;
+  bool euclidean_metrics = (typeid(*metrics_) == typeid(Metrics)); //the utopia is the euclidean distance
   for(const PathPtr& p:admissible_other_paths_)
   {
     nodes = p->getNodes();
@@ -382,13 +408,16 @@ std::vector<ps_goal_ptr> MARS::sortNodes(const NodePtr& start_node)
     else
       start_node_belongs_to_p = false;
 
-    for(const NodePtr& n:nodes)
+    (this->*nodes_distance_)(start_node->getConfiguration(),nodes,distances);
+
+    for(unsigned int i=0;i<nodes.size();i++)
     {
+      const NodePtr& n = nodes[i];
       if(std::find(considered_nodes.begin(),considered_nodes.end(),n)<considered_nodes.end())
         continue;
 
-      euclidean_distance = (start_node->getConfiguration(),n->getConfiguration()).norm();
-      utopia = metrics_->utopia(start_node->getConfiguration(),n->getConfiguration());
+      euclidean_distance = distances[i];
+      utopia = euclidean_metrics? euclidean_distance:metrics_->utopia(start_node->getConfiguration(),n->getConfiguration());
 
       if(utopia<TOLERANCE)
         continue;
@@ -971,12 +1000,12 @@ bool MARS::computeConnectingPath(const NodePtr& path1_node, const NodePtr& path2
    * by diff_subpath_cost is used to sample the space. Outside of this ellipsoid,
    * the nodes would create an inconvenient connecting_path */
 
-  SamplerPtr sampler = std::make_shared<InformedSampler>(path1_node->getConfiguration(),
-                                                         path2_node->getConfiguration(),
-                                                         lb_, ub_,diff_subpath_cost);
+  SamplerPtr sampler = makeInformedSampler(path1_node->getConfiguration(),
+                                           path2_node->getConfiguration(),
+                                           diff_subpath_cost);
 
   std::vector<NodePtr> subtree_nodes;
-  NodePtr path2_node_fake = std::make_shared<Node>(path2_node->getConfiguration());
+  NodePtr path2_node_fake = makeNode(path2_node->getConfiguration());
 
   bool solver_has_solved = false;
   bool valid_connecting_path_found = false;
@@ -985,7 +1014,7 @@ bool MARS::computeConnectingPath(const NodePtr& path1_node, const NodePtr& path2
   double available_search_time = solver_time;
   ros::WallTime tic_before_search = ros::WallTime::now();
 
-  while(available_search_time>0)
+  while(available_search_time>0 && not stop_)
   {
     solver_->resetProblem();
     solver_->setSampler(sampler);
@@ -1106,6 +1135,7 @@ bool MARS::computeConnectingPath(const NodePtr& path1_node, const NodePtr& path2
                }());
 
         valid_connecting_path_found = true;
+        storeFreeConfigurations(connecting_path->getNodes()); //all its connections are valid in the current world
         break;
       }
       else
@@ -1173,7 +1203,7 @@ bool MARS::computeConnectingPath(const NodePtr& path1_node, const NodePtr& path2
         assert(last_conn != nullptr);
         assert(last_conn->getChild() == path2_node_fake);
 
-        ConnectionPtr new_conn= std::make_shared<Connection>(last_conn->getParent(),path2_node,(path2_node->getParentConnectionsSize()>0));
+        ConnectionPtr new_conn= makeConnection(last_conn->getParent(),path2_node,(path2_node->getParentConnectionsSize()>0));
         new_conn->setCost(last_conn->getCost());
         new_conn->add();
 
@@ -1527,7 +1557,7 @@ bool MARS::pathSwitch(const PathPtr &current_path,
 
     toc=ros::WallTime::now();
     time = pathSwitch_max_time_ - (toc-tic).toSec();
-    if((!an_obstacle_ && time<time_percentage_variability_*pathSwitch_cycle_time_mean_ && pathSwitch_cycle_time_mean_ != std::numeric_limits<double>::infinity()) || time<=0.0)  //if there is an obstacle, you should use the entire available time to find a feasible solution
+    if((!an_obstacle_ && time<time_percentage_variability_*pathSwitch_cycle_time_mean_ && pathSwitch_cycle_time_mean_ != std::numeric_limits<double>::infinity()) || time<=0.0 || stop_)  //if there is an obstacle, you should use the entire available time to find a feasible solution
     {
       if(pathSwitch_verbose_)
         ROS_BLUE_STREAM("TIME OUT! max time: "<<pathSwitch_max_time_<<", time_available: "<<time<<", time needed for a new cycle: "<<time_percentage_variability_*pathSwitch_cycle_time_mean_<<"; "<<remaining_goals<<" goals not considered.");
@@ -45,6 +45,146 @@ MPRRT::MPRRT(Eigen::VectorXd& current_configuration,
   }
 
   connecting_path_vector_.resize(number_of_parallel_plannings_,nullptr);
+  pool_ = std::make_shared<WorkerPool>(number_of_parallel_plannings_-1);
+
+  shared_tree_ = false;
+  shared_tree_max_distance_ = 0.0;
+  shared_tree_capacity_ = SHARED_TREE_CAPACITY;
+  shared_tree_best_cost_ = std::numeric_limits<double>::infinity();
+  concurrent_tree_ = nullptr;
+
+  tree_reuse_ = false;
+  max_reused_tree_nodes_ = MAX_REUSED_TREE_NODES;
+  worker_trees_.resize(number_of_parallel_plannings_,nullptr);
+  worker_goals_.resize(number_of_parallel_plannings_,nullptr);
+  worker_trees_world_version_.resize(number_of_parallel_plannings_,0);
+}
+
+void MPRRT::asyncGrowSharedTree(const Eigen::VectorXd goal_conf,
+                                const double current_solution_cost,
+                                const int index)
+{
+  ros::WallTime tic = ros::WallTime::now();
+
+  CollisionCheckerPtr checker = solver_vector_.at(index)->getChecker();
+  MetricsPtr metrics = solver_vector_.at(index)->getMetrics();
+
+  double best_cost = current_solution_cost;
+  InformedSamplerPtr sampler = makeInformedSampler(concurrent_tree_->getConfiguration(0),goal_conf,best_cost,checker);
+
+  int iter = 0;
+  int parent_idx, new_idx;
+  double distance, cost, cost2goal, shared_best_cost;
+  Eigen::VectorXd q, parent_conf, new_conf;
+
+  while((0.98*max_time_-(ros::WallTime::now()-tic).toSec())>0.0 && not stop_ && ros::ok())
+  {
+    iter++;
+
+    shared_best_cost = shared_tree_best_cost_; //solutions found by the other threads shrink the informed set too
+    if(shared_best_cost<best_cost)
+    {
+      best_cost = shared_best_cost;
+      sampler->setCost(best_cost);
+    }
+
+    q = sampler->sample();
+    parent_idx = concurrent_tree_->nearest(q,distance);
+    if(distance<TOLERANCE)
+      continue;
+
+    parent_conf = concurrent_tree_->getConfiguration(parent_idx);
+    if(distance>shared_tree_max_distance_)
+      new_conf = parent_conf+(q-parent_conf)*(shared_tree_max_distance_/distance);
+    else
+      new_conf = q;
+
+    if(not checker->checkPath(parent_conf,new_conf))
+      continue;
+
+    cost = concurrent_tree_->getCost(parent_idx)+metrics->cost(parent_conf,new_conf);
+    new_idx = concurrent_tree_->add(new_conf,parent_idx,cost);
+    if(new_idx<0)
+    {
+      if(verbose_)
+        ROS_WARN("Shared tree full");
+      break;
+    }
+
+    if((new_conf-goal_conf).norm()>shared_tree_max_distance_)
+      continue;
+
+    cost2goal = cost+metrics->cost(new_conf,goal_conf);
+
+    if(cost2goal<best_cost && checker->checkPath(new_conf,goal_conf))
+    {
+      mtx_.lock();
+      if(cost2goal<shared_tree_best_cost_)
+      {
+        shared_tree_best_cost_ = cost2goal;
+        shared_tree_best_idx_ = new_idx;
+      }
+      best_cost = shared_tree_best_cost_;
+      mtx_.unlock();
+
+      sampler->setCost(best_cost);
+    }
+  }
+
+  if(verbose_)
+    ROS_INFO_STREAM("\n--- THREAD REASUME ---\nthread n: "<<index<<" (shared tree)\nn iter: "<<iter<<" time: "<<(ros::WallTime::now()-tic).toSec());
+}
+
+PathPtr MPRRT::sharedTreeConnectingPath(const Eigen::VectorXd& path1_node_conf,
+                                        const Eigen::VectorXd& path2_node_conf,
+                                        const double& current_solution_cost)
+{
+  concurrent_tree_ = std::make_shared<ConcurrentTree>(path1_node_conf,shared_tree_capacity_);
+  shared_tree_best_idx_ = -1;
+  shared_tree_best_cost_ = current_solution_cost;
+
+  graph_pool::TaskCounters counters;
+  pool_->parallelFor(number_of_parallel_plannings_,[&](const unsigned int& i){
+    counters.run([&](){asyncGrowSharedTree(path2_node_conf,current_solution_cost,i);});
+  });
+
+  if(verbose_)
+    ROS_INFO_STREAM("Shared tree nodes: "<<concurrent_tree_->size());
+
+  if(free_reservoir_) //the tree is discarded, keep some of its free configurations
+  {
+    unsigned int tree_size = concurrent_tree_->size();
+    unsigned int stride = std::max<unsigned int>(1,tree_size/FREE_RESERVOIR_MAX_ADD);
+    for(unsigned int i=1;i<tree_size;i+=stride)
+      free_reservoir_->add(concurrent_tree_->getConfiguration(i),world_version_);
+  }
+
+  if(shared_tree_best_idx_<0)
+    return nullptr;
+
+  /* Build the connecting path from the branch of the best node, plus the connection to the goal */
+  std::vector<int> branch = concurrent_tree_->branch(shared_tree_best_idx_);
+  std::vector<ConnectionPtr> connections;
+
+  NodePtr parent = makeNode(concurrent_tree_->getConfiguration(branch.front()));
+  NodePtr child;
+  for(unsigned int i=1;i<=branch.size();i++)
+  {
+    (i<branch.size())?
+          (child = makeNode(concurrent_tree_->getConfiguration(branch.at(i)))):
+          (child = makeNode(path2_node_conf));
+
+    ConnectionPtr conn = makeConnection(parent,child,false);
+    conn->setCost(metrics_->cost(parent,child));
+    conn->add();
+
+    connections.push_back(conn);
+    parent = child;
+  }
+
+  concurrent_tree_ = nullptr;
+
+  return std::make_shared<Path>(connections,metrics_,checker_);
 }
 
 bool MPRRT::asyncComputeConnectingPath(const Eigen::VectorXd path1_node_conf,
@@ -66,16 +206,21 @@ bool MPRRT::asyncComputeConnectingPath(const Eigen::VectorXd path1_node_conf,
   {
     iter++;
 
-    NodePtr path1_node = std::make_shared<Node>(path1_node_conf);
-    NodePtr path2_node = std::make_shared<Node>(path2_node_conf);
+    NodePtr path1_node = makeNode(path1_node_conf);
+    NodePtr path2_node = makeNode(path2_node_conf);
 
     PathPtr connecting_path = nullptr;
     bool directly_connected = false;
 
     time = max_time_-(ros::WallTime::now()-tic).toSec();
 
-    bool solved = computeConnectingPath(path1_node,path2_node,current_solution_cost,time,
-                                        connecting_path,directly_connected,solver);
+    bool solved;
+    if(tree_reuse_)
+      solved = computeConnectingPathReusingTree(path1_node,path2_node,current_solution_cost,time,
+                                                connecting_path,directly_connected,index);
+    else
+      solved = computeConnectingPath(path1_node,path2_node,current_solution_cost,time,
+                                     connecting_path,directly_connected,solver);
 
     if(solved)
     {
@@ -84,11 +229,14 @@ bool MPRRT::asyncComputeConnectingPath(const Eigen::VectorXd path1_node_conf,
       double new_cost = connecting_path->cost();
       if(new_cost<best_cost)
       {
-        best_solution = connecting_path;
+        //the connections of a reused tree change in the next iterations and concatWithNewPathToGoal removes some of them, so keep a copy
+        tree_reuse_?
+              (best_solution = connecting_path->clone()):
+              (best_solution = connecting_path);
         best_cost = new_cost;
       }
     }
-  } while((0.98*max_time_-(ros::WallTime::now()-tic).toSec())>0.0 && ros::ok());
+  } while((0.98*max_time_-(ros::WallTime::now()-tic).toSec())>0.0 && not stop_ && ros::ok());
 
   mtx_.lock();
   connecting_path_vector_.at(index) = best_solution;
@@ -109,7 +257,6 @@ bool MPRRT::connect2goal(const NodePtr& node)
 {
   success_ = false;
   bool solved = false;
-  std::vector<std::shared_future<bool>> futures;
 
   double current_cost = current_path_->getCostFromConf(node->getConfiguration());
 
@@ -125,47 +272,62 @@ bool MPRRT::connect2goal(const NodePtr& node)
       ROS_WARN("Current path obstructed");
   }
 
-  for(unsigned int i=0; i<number_of_parallel_plannings_;i++)
+  PathPtr best_connecting_path = nullptr;
+
+  if(shared_tree_)
   {
-    int index = i;
-    futures.push_back(std::async(std::launch::async,
-                                 &MPRRT::asyncComputeConnectingPath,
-                                 this,node->getConfiguration(),
-                                 goal_node_->getConfiguration(),current_cost,index));
+    best_connecting_path = sharedTreeConnectingPath(node->getConfiguration(),goal_node_->getConfiguration(),current_cost);
+    solved = (best_connecting_path != nullptr);
   }
+  else
+  {
+    Eigen::VectorXd node_conf = node->getConfiguration();
+    Eigen::VectorXd goal_conf = goal_node_->getConfiguration();
+    std::vector<char> solved_vector(number_of_parallel_plannings_,false);
 
-  std::vector<double> marker_color;
-  marker_color = {1.0,1.0,0.0,1.0};
+    {
+      graph_pool::TaskCounters counters; //the allocations of the workers are reported with the ones of this thread
+      pool_->parallelFor(number_of_parallel_plannings_,[&](const unsigned int& i){
+        counters.run([&](){solved_vector[i] = asyncComputeConnectingPath(node_conf,goal_conf,current_cost,i);});
+      });
+    }
 
-  unsigned int idx_best_sol = -1;
-  double best_cost = std::numeric_limits<double>::infinity();
+    std::vector<double> marker_color;
+    marker_color = {1.0,1.0,0.0,1.0};
 
-  for(unsigned int i=0; i<number_of_parallel_plannings_;i++)
-  {
-    if(futures.at(i).get())
+    unsigned int idx_best_sol = -1;
+    double best_cost = std::numeric_limits<double>::infinity();
+
+    for(unsigned int i=0; i<number_of_parallel_plannings_;i++)
     {
-      assert(connecting_path_vector_.at(i));
+      if(solved_vector.at(i))
+      {
+        assert(connecting_path_vector_.at(i));
 
-      solved = true;
-      double i_cost = connecting_path_vector_.at(i)->cost();
+        solved = true;
+        double i_cost = connecting_path_vector_.at(i)->cost();
 
-      if(i_cost<best_cost)
-      {
-        best_cost = i_cost;
-        idx_best_sol = i;
+        if(i_cost<best_cost)
+        {
+          best_cost = i_cost;
+          idx_best_sol = i;
 
-        if(verbose_)
-          ROS_INFO_STREAM("New cost: "<<best_cost);
-      }
+          if(verbose_)
+            ROS_INFO_STREAM("New cost: "<<best_cost);
+        }
 
-      if(verbose_ && disp_)
-        disp_->displayPath(connecting_path_vector_.at(i),"pathplan",marker_color);
+        if(verbose_ && disp_)
+          disp_->displayPath(connecting_path_vector_.at(i),"pathplan",marker_color);
+      }
     }
+
+    if(solved)
+      best_connecting_path = connecting_path_vector_.at(idx_best_sol);
   }
 
   if(solved)
   {
-    std::vector<ConnectionPtr>  connecting_path_conn = connecting_path_vector_.at(idx_best_sol)->getConnections();
+    std::vector<ConnectionPtr>  connecting_path_conn = best_connecting_path->getConnections();
     PathPtr new_path = concatWithNewPathToGoal(connecting_path_conn, node);
     replanned_path_ = new_path;
     double replanned_path_cost = replanned_path_->cost();
@@ -198,15 +360,15 @@ PathPtr MPRRT::concatWithNewPathToGoal(const std::vector<ConnectionPtr>& connect
                                        const NodePtr& path1_node)
 {
   std::vector<ConnectionPtr> new_connecting_path_conn;
-  NodePtr path2_node = std::make_shared<Node>(current_path_->getWaypoints().back());
+  NodePtr path2_node = makeNode(current_path_->getWaypoints().back());
 
   if(connecting_path_conn.size()>1)
   {
     NodePtr node1 = connecting_path_conn.front()->getChild();
     NodePtr node2 = connecting_path_conn.back()->getParent();
 
-    ConnectionPtr conn1 = std::make_shared<Connection>(path1_node,node1,false);
-    ConnectionPtr conn2 = std::make_shared<Connection>(node2,path2_node,false);
+    ConnectionPtr conn1 = makeConnection(path1_node,node1,false);
+    ConnectionPtr conn2 = makeConnection(node2,path2_node,false);
 
     conn1->setCost(connecting_path_conn.front()->getCost());
     conn2->setCost(connecting_path_conn.back()->getCost());
@@ -226,7 +388,7 @@ PathPtr MPRRT::concatWithNewPathToGoal(const std::vector<ConnectionPtr>& connect
   }
   else
   {
-    ConnectionPtr conn1 = std::make_shared<Connection>(path1_node,path2_node,false);
+    ConnectionPtr conn1 = makeConnection(path1_node,path2_node,false);
     conn1->setCost(connecting_path_conn.front()->getCost());
     conn1->add();
 
@@ -245,7 +407,7 @@ bool MPRRT::computeConnectingPath(const NodePtr &path1_node_fake,
                                   bool &directly_connected,
                                   TreeSolverPtr& solver)
 {
-  SamplerPtr sampler = std::make_shared<InformedSampler>(path1_node_fake->getConfiguration(), path2_node_fake->getConfiguration(), lb_, ub_,current_solution_cost);
+  SamplerPtr sampler = makeInformedSampler(path1_node_fake->getConfiguration(), path2_node_fake->getConfiguration(), current_solution_cost, solver->getChecker());
 
   solver->setSampler(sampler);
   solver->resetProblem();
@@ -269,6 +431,151 @@ bool MPRRT::computeConnectingPath(const NodePtr &path1_node_fake,
     solver_has_solved = solver->solve(connecting_path,10000,solver_time);
   }
 
+  if(not tree_reuse_) //the tree is discarded at the next iteration, keep some of its free configurations
+    storeFreeConfigurations(solver->getStartTree()->getNodes());
+
+  return solver_has_solved;
+}
+
+TreePtr MPRRT::reuseTree(const NodePtr& start_node, const double& max_time, const int index)
+{
+  ros::WallTime tic = ros::WallTime::now();
+
+  TreePtr tree = worker_trees_.at(index);
+  if(tree == nullptr)
+    return nullptr;
+
+  if(tree->getNumberOfNodes()>max_reused_tree_nodes_)
+  {
+    worker_trees_.at(index) = nullptr;
+    return nullptr;
+  }
+
+  CollisionCheckerPtr checker = solver_vector_.at(index)->getChecker();
+
+  //Remove the goal node of the previous iteration, a new one is connected by the solver
+  std::vector<NodePtr> white_list;
+  unsigned int removed_nodes;
+
+  NodePtr old_goal = worker_goals_.at(index);
+  if(old_goal != nullptr && tree->isInTree(old_goal))
+    tree->purgeFromHere(old_goal,white_list,removed_nodes);
+
+  worker_goals_.at(index) = nullptr;
+
+  //If the world has changed, prune the branches below the invalid connections with a top-down visit from the root
+  if(worker_trees_world_version_.at(index) != world_version_)
+  {
+    NodePtr parent, child;
+    std::vector<NodePtr> stack;
+    std::vector<ConnectionPtr> child_connections;
+    stack.push_back(tree->getRoot());
+
+    while(not stack.empty())
+    {
+      if((ros::WallTime::now()-tic).toSec()>=max_time)
+      {
+        //a partially checked tree can not be reused
+        worker_trees_.at(index) = nullptr;
+        return nullptr;
+      }
+
+      parent = stack.back();
+      stack.pop_back();
+
+      child_connections = parent->getChildConnections();
+      for(const ConnectionPtr& conn:child_connections)
+      {
+        child = conn->getChild();
+        if(checker->checkConnection(conn))
+          stack.push_back(child);
+        else
+          tree->purgeFromHere(child,white_list,removed_nodes);
+      }
+    }
+
+    worker_trees_world_version_.at(index) = world_version_;
+  }
+
+  //Re-root the tree at the new start node
+  double distance;
+  NodePtr closest_node = tree->findClosestNode(start_node->getConfiguration());
+  distance = (closest_node->getConfiguration()-start_node->getConfiguration()).norm();
+
+  if(distance<TOLERANCE)
+  {
+    if(closest_node != tree->getRoot())
+      tree->changeRoot(closest_node);
+  }
+  else
+  {
+    if(not checker->checkPath(closest_node->getConfiguration(),start_node->getConfiguration()))
+    {
+      worker_trees_.at(index) = nullptr;
+      return nullptr;
+    }
+
+    ConnectionPtr conn = makeConnection(closest_node,start_node);
+    conn->setCost(metrics_->cost(closest_node,start_node));
+    conn->add();
+
+    tree->addNode(start_node,false);
+    tree->changeRoot(start_node);
+  }
+
+  return tree;
+}
+
+bool MPRRT::computeConnectingPathReusingTree(const NodePtr &path1_node_fake,
+                                             const NodePtr &path2_node_fake,
+                                             const double &current_solution_cost,
+                                             const double max_time,
+                                             PathPtr &connecting_path,
+                                             bool &directly_connected,
+                                             const int index)
+{
+  ros::WallTime tic = ros::WallTime::now();
+
+  TreeSolverPtr solver = solver_vector_.at(index);
+  TreePtr tree = reuseTree(path1_node_fake,0.5*max_time,index);
+
+  if(tree == nullptr)
+  {
+    worker_trees_world_version_.at(index) = world_version_;
+
+    double solver_time = max_time-(ros::WallTime::now()-tic).toSec(); //the failed reuse may have taken up to half of max_time
+    bool solved = computeConnectingPath(path1_node_fake,path2_node_fake,current_solution_cost,solver_time,
+                                        connecting_path,directly_connected,solver);
+
+    worker_trees_.at(index) = solver->getStartTree();
+    worker_goals_.at(index) = path2_node_fake;
+
+    return solved;
+  }
+
+  SamplerPtr sampler = makeInformedSampler(path1_node_fake->getConfiguration(), path2_node_fake->getConfiguration(), current_solution_cost, solver->getChecker());
+
+  solver->setSampler(sampler);
+  solver->resetProblem();
+  solver->addStartTree(tree);
+
+  solver->addGoal(path2_node_fake,max_time-(ros::WallTime::now()-tic).toSec());
+  worker_goals_.at(index) = path2_node_fake;
+
+  directly_connected = solver->solved();
+  bool solver_has_solved;
+
+  if(directly_connected)
+  {
+    connecting_path = solver->getSolution();
+    solver_has_solved = true;
+  }
+  else
+  {
+    double solver_time = max_time-(ros::WallTime::now()-tic).toSec();
+    solver_has_solved = solver->solve(connecting_path,10000,solver_time);
+  }
+
   return solver_has_solved;
 }
 
@@ -61,15 +61,15 @@ bool AnytimeDynamicRRT::improvePath(NodePtr &node, const double& max_time)
   PathPtr solution;
   double cost2beat;
   double time = (ros::WallTime::now()-tic).toSec();
-  while(time<max_time && n_fail<FAILED_ITER)
+  while(time<max_time && n_fail<FAILED_ITER && not stop_)
   {
     cost2beat = (1-imprv)*path_cost;
 
     if(verbose_)
       ROS_INFO_STREAM("Path cost: "<<path_cost<<", cost2beat: "<<cost2beat);
 
-    NodePtr start_node = std::make_shared<Node>(node->getConfiguration());
-    NodePtr goal_node  = std::make_shared<Node>(goal_node_->getConfiguration());
+    NodePtr start_node = makeNode(node->getConfiguration());
+    NodePtr goal_node  = makeNode(goal_node_->getConfiguration());
 
     bool improved = forced_cast_solver->improve(start_node,goal_node,solution,cost2beat,10000,(max_time-time));
 
@@ -104,6 +104,19 @@ bool AnytimeDynamicRRT::improvePath(NodePtr &node, const double& max_time)
   return success;
 }
 
+void AnytimeDynamicRRT::setImprovedPath(const PathPtr& path)
+{
+  assert(path->getTree());
+
+  replanned_path_ = path;
+  goal_node_ = path->getGoalNode();
+
+  solver_->setStartTree(path->getTree());
+  solver_->setSolution(path,true);  //should be after setStartTree
+
+  success_ = true;
+}
+
 bool AnytimeDynamicRRT::replan()
 {
   ros::WallTime tic = ros::WallTime::now();
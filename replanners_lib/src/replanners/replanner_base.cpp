@@ -21,7 +21,12 @@ ReplannerBase::ReplannerBase(const Eigen::VectorXd& current_configuration,
   ub_ = solver->getSampler()->getUB();
 
   max_time_ = max_time;
+  stop_ = false;
   success_ = false;
+  world_version_ = 0;
+  sample_reservoir_ = nullptr;
+  free_reservoir_ = nullptr;
+  free_reservoir_bias_ = 0.0;
 
   disp_ = nullptr;
   verbose_ = false;
@@ -33,4 +38,51 @@ ReplannerBase::~ReplannerBase()
 {
 }
 
+InformedSamplerPtr ReplannerBase::makeInformedSampler(const Eigen::VectorXd& start, const Eigen::VectorXd& goal,
+                                                      const double& cost, const CollisionCheckerPtr& checker)
+{
+  InformedSamplerPtr sampler;
+  if(sample_reservoir_)
+    sampler = std::make_shared<ReservoirInformedSampler>(start,goal,lb_,ub_,sample_reservoir_,cost);
+  else
+    sampler = std::make_shared<InformedSampler>(start,goal,lb_,ub_,cost);
+
+  if(free_reservoir_ && free_reservoir_bias_>0.0)
+  {
+    CollisionCheckerPtr reservoir_checker = checker? checker:checker_;
+    sampler = std::make_shared<FreeReservoirSampler>(start,goal,lb_,ub_,sampler,free_reservoir_,reservoir_checker,
+                                                     world_version_,free_reservoir_bias_,cost);
+  }
+
+  return sampler;
+}
+
+void ReplannerBase::storeFreeConfigurations(const std::vector<NodePtr>& nodes)
+{
+  if(free_reservoir_ == nullptr || nodes.empty())
+    return;
+
+  unsigned int stride = std::max<unsigned int>(1,nodes.size()/FREE_RESERVOIR_MAX_ADD);
+  for(unsigned int i=0;i<nodes.size();i+=stride)
+    free_reservoir_->add(nodes[i]->getConfiguration(),world_version_);
+}
+
+InformedSamplerPtr ReplannerBase::makeLocalSampler(const Eigen::VectorXd& start, const Eigen::VectorXd& goal,
+                                                   const Eigen::VectorXd& ball_center, const double& ball_radius,
+                                                   const double& cost)
+{
+  if(sample_reservoir_)
+  {
+    ReservoirInformedSamplerPtr sampler = std::make_shared<ReservoirInformedSampler>(start,goal,lb_,ub_,sample_reservoir_,cost);
+    sampler->addBall(ball_center,ball_radius);
+    return sampler;
+  }
+  else
+  {
+    LocalInformedSamplerPtr sampler = std::make_shared<LocalInformedSampler>(start,goal,lb_,ub_,cost);
+    sampler->addBall(ball_center,ball_radius);
+    return sampler;
+  }
+}
+
 }
@@ -0,0 +1,244 @@
+#include "replanners_lib/sample_reservoir.h"
+#include <eigen3/Eigen/QR>
+
+namespace pathplan
+{
+
+double SampleReservoir::radicalInverse(unsigned int index, const unsigned int& base)
+{
+  double inv_base = 1.0/base;
+  double f = inv_base;
+  double r = 0.0;
+
+  while(index>0)
+  {
+    r += f*(index%base);
+    index /= base;
+    f *= inv_base;
+  }
+  return r;
+}
+
+std::vector<unsigned int> SampleReservoir::primes(const unsigned int& n)
+{
+  std::vector<unsigned int> p;
+  unsigned int candidate = 2;
+  while(p.size()<n)
+  {
+    bool is_prime = true;
+    for(const unsigned int& q:p)
+    {
+      if(q*q>candidate)
+        break;
+      if(candidate%q == 0)
+      {
+        is_prime = false;
+        break;
+      }
+    }
+    if(is_prime)
+      p.push_back(candidate);
+
+    candidate++;
+  }
+  return p;
+}
+
+SampleReservoir::SampleReservoir(const unsigned int& dof, const unsigned int& size, const unsigned int& seed)
+{
+  if(dof<1 || size<1)
+    throw std::invalid_argument("sample reservoir dof and size must be at least 1");
+
+  dof_ = dof;
+  size_ = size;
+  cursor_.store(0,std::memory_order_relaxed);
+
+  /* Dimensions of the Halton sequence: the cube uses the first dof_, the ball uses Box-Muller pairs for the direction
+   * (dof_ rounded up to an even number) plus one dimension for the radius */
+  unsigned int n_pairs = (dof_+1)/2;
+  unsigned int n_dims = std::max(dof_,2*n_pairs+1);
+  std::vector<unsigned int> bases = primes(n_dims);
+
+  //Cranley-Patterson rotation: a random shift per dimension breaks the correlation between the high prime bases
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> ud(0.0,1.0);
+  std::vector<double> shift(n_dims);
+  for(double& s:shift)
+    s = ud(gen);
+
+  Eigen::MatrixXd halton(n_dims,size_);
+  for(unsigned int i=0;i<size_;i++)
+  {
+    for(unsigned int d=0;d<n_dims;d++)
+    {
+      double u = radicalInverse(i+1,bases[d])+shift[d];
+      halton(d,i) = u-std::floor(u);
+    }
+  }
+
+  cube_ = halton.topRows(dof_);
+
+  ball_.resize(dof_,size_);
+  Eigen::VectorXd direction(2*n_pairs);
+  for(unsigned int i=0;i<size_;i++)
+  {
+    for(unsigned int p=0;p<n_pairs;p++)
+    {
+      double rho = std::sqrt(-2.0*std::log(std::max(halton(2*p,i),1.0e-12)));
+      double theta = 2.0*M_PI*halton(2*p+1,i);
+
+      direction(2*p  ) = rho*std::cos(theta);
+      direction(2*p+1) = rho*std::sin(theta);
+    }
+
+    double norm = direction.head(dof_).norm();
+    if(norm<1.0e-12)
+    {
+      ball_.col(i).setZero();
+      continue;
+    }
+
+    double radius = std::pow(halton(2*n_pairs,i),1.0/dof_);
+    ball_.col(i) = direction.head(dof_)*(radius/norm);
+  }
+}
+
+ReservoirInformedSampler::ReservoirInformedSampler(const Eigen::VectorXd& start_configuration,
+                                                   const Eigen::VectorXd& stop_configuration,
+                                                   const Eigen::VectorXd& lower_bound,
+                                                   const Eigen::VectorXd& upper_bound,
+                                                   const SampleReservoirPtr& reservoir,
+                                                   const double& cost):
+  InformedSampler(start_configuration,stop_configuration,lower_bound,upper_bound,cost)
+{
+  if(reservoir == nullptr || reservoir->getDof() != lower_bound.size())
+    throw std::invalid_argument("sample reservoir not consistent with the bounds");
+
+  reservoir_ = reservoir;
+
+  focus1_ = start_configuration;
+  focus2_ = stop_configuration;
+  center_ = 0.5*(focus1_+focus2_);
+  focii_dist_ = (focus2_-focus1_).norm();
+
+  direction_ = Eigen::VectorXd::Zero(focus1_.size());
+  if(focii_dist_>0.0)
+    direction_ = (focus2_-focus1_)/focii_dist_;
+
+  box_lb_ = lower_bound;
+  box_range_ = upper_bound-lower_bound;
+
+  ball_gen_.seed(reservoir_->next(pass_));
+  randomize();
+
+  setCost(cost);
+}
+
+void ReservoirInformedSampler::randomize()
+{
+  unsigned int dof = reservoir_->getDof();
+
+  std::uniform_real_distribution<double> ud(0.0,1.0);
+  cube_shift_.resize(dof);
+  for(unsigned int d=0;d<dof;d++)
+    cube_shift_(d) = ud(ball_gen_);
+
+  //Q factor of a gaussian matrix, with the signs fixed by the diagonal of R: uniformly distributed rotation
+  std::normal_distribution<double> nd(0.0,1.0);
+  Eigen::MatrixXd gaussian(dof,dof);
+  for(unsigned int i=0;i<dof;i++)
+    for(unsigned int j=0;j<dof;j++)
+      gaussian(i,j) = nd(ball_gen_);
+
+  Eigen::HouseholderQR<Eigen::MatrixXd> qr(gaussian);
+  ball_rotation_ = qr.householderQ();
+  Eigen::MatrixXd r = qr.matrixQR();
+  for(unsigned int d=0;d<dof;d++)
+  {
+    if(r(d,d)<0.0)
+      ball_rotation_.col(d) = -ball_rotation_.col(d);
+  }
+}
+
+void ReservoirInformedSampler::setCost(const double& cost)
+{
+  InformedSampler::setCost(cost);
+
+  ellipse_cost_ = cost;
+  informed_ = (cost<std::numeric_limits<double>::infinity());
+
+  if(informed_)
+  {
+    major_radius_ = 0.5*cost;
+    minor_radius_ = 0.5*std::sqrt(std::max(0.0,cost*cost-focii_dist_*focii_dist_));
+
+    //an ellipsoid larger than the bounds is better sampled through the bounds
+    sample_box_ = (major_radius_>=0.5*box_range_.norm());
+  }
+  else
+  {
+    major_radius_ = minor_radius_ = std::numeric_limits<double>::infinity();
+    sample_box_ = true;
+  }
+}
+
+void ReservoirInformedSampler::addBall(const Eigen::VectorXd& center, const double& radius)
+{
+  balls_centers_.push_back(center);
+  balls_radii_.push_back(radius);
+}
+
+void ReservoirInformedSampler::clearBalls()
+{
+  balls_centers_.clear();
+  balls_radii_.clear();
+}
+
+Eigen::VectorXd ReservoirInformedSampler::sample()
+{
+  Eigen::VectorXd q, u, y;
+  unsigned int idx, ball;
+  unsigned long pass;
+
+  for(unsigned int t=0;t<MAX_RESERVOIR_TRIES;t++)
+  {
+    idx = reservoir_->next(pass);
+    if(pass != pass_) //the cursor has wrapped around the reservoir, change the randomization not to repeat the samples
+    {
+      pass_ = pass;
+      randomize();
+    }
+
+    if(not balls_centers_.empty())
+    {
+      ball = ball_gen_()%balls_centers_.size();
+      y.noalias() = ball_rotation_*reservoir_->getUnitBall(idx);
+      q = balls_centers_[ball]+balls_radii_[ball]*y;
+
+      if(informed_ && not inEllipse(q))
+        continue;
+    }
+    else if(sample_box_)
+    {
+      u = reservoir_->getUnitCube(idx)+cube_shift_;  //Cranley-Patterson rotation
+      u = u.array()-u.array().floor();
+      q = box_lb_+box_range_.cwiseProduct(u);
+
+      if(informed_ && not inEllipse(q))
+        continue;
+    }
+    else
+    {
+      //unit ball -> ellipsoid: the component along the focii axis is scaled by the major radius, the others by the minor one
+      y.noalias() = ball_rotation_*reservoir_->getUnitBall(idx);
+      q = center_+minor_radius_*y+((major_radius_-minor_radius_)*direction_.dot(y))*direction_;
+    }
+
+    if(inBox(q))
+      return q;
+  }
+
+  return InformedSampler::sample(); //rejection sampling in the bounds and the informed set
+}
+
+}
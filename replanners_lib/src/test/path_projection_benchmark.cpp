@@ -0,0 +1,96 @@
+#include <ros/ros.h>
+#include <random>
+#include <replanners_lib/path_index.h>
+
+/* Compares the projection of configurations on a path done by graph_core (Path::findConnection, Path::projectOnPath)
+ * with the vectorized kernels of PathIndex, for paths of different dof and number of connections */
+
+pathplan::PathPtr randomPath(const unsigned int& dof, const unsigned int& n_conns, std::mt19937& gen)
+{
+  std::uniform_real_distribution<double> step(-0.2,0.2);
+  pathplan::MetricsPtr metrics = std::make_shared<pathplan::Metrics>();
+
+  Eigen::VectorXd q = Eigen::VectorXd::Zero(dof);
+  pathplan::NodePtr parent = std::make_shared<pathplan::Node>(q);
+
+  std::vector<pathplan::ConnectionPtr> conns;
+  for(unsigned int i=0;i<n_conns;i++)
+  {
+    for(unsigned int d=0;d<dof;d++)
+      q(d) += step(gen);
+
+    pathplan::NodePtr child = std::make_shared<pathplan::Node>(q);
+    pathplan::ConnectionPtr conn = std::make_shared<pathplan::Connection>(parent,child,false);
+    conn->setCost(metrics->cost(parent,child));
+    conn->add();
+
+    conns.push_back(conn);
+    parent = child;
+  }
+
+  return std::make_shared<pathplan::Path>(conns,metrics,nullptr);
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "path_projection_benchmark");
+  ros::NodeHandle nh("~");
+
+  int n_queries, n_conns;
+  nh.param("n_queries",n_queries,10000);
+  nh.param("n_connections",n_conns,50);
+
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> noise(-0.05,0.05);
+
+  for(const unsigned int dof:{3,6,12,18})
+  {
+    pathplan::PathPtr path = randomPath(dof,n_conns,gen);
+    pathplan::PathIndex index(path);
+
+    std::vector<Eigen::VectorXd> on_path, off_path;
+    std::uniform_real_distribution<double> abscissa(0.0,1.0);
+    for(int i=0;i<n_queries;i++)
+    {
+      Eigen::VectorXd q = index.pointOnCurvilinearAbscissa(abscissa(gen));
+      on_path.push_back(q);
+
+      for(unsigned int d=0;d<dof;d++)
+        q(d) += noise(gen);
+      off_path.push_back(q);
+    }
+
+    int idx;
+    int checksum = 0;
+    ros::WallTime tic = ros::WallTime::now();
+    for(const Eigen::VectorXd& q:on_path)
+    {
+      path->findConnection(q,idx);
+      checksum += idx;
+    }
+    double t_find_path = (ros::WallTime::now()-tic).toSec();
+
+    tic = ros::WallTime::now();
+    for(const Eigen::VectorXd& q:on_path)
+      checksum += index.findConnection(q);
+    double t_find_index = (ros::WallTime::now()-tic).toSec();
+
+    tic = ros::WallTime::now();
+    for(const Eigen::VectorXd& q:off_path)
+      checksum += path->projectOnPath(q).size();
+    double t_proj_path = (ros::WallTime::now()-tic).toSec();
+
+    double distance;
+    Eigen::VectorXd projection;
+    tic = ros::WallTime::now();
+    for(const Eigen::VectorXd& q:off_path)
+      checksum += index.nearestConnection(q,projection,distance);
+    double t_proj_index = (ros::WallTime::now()-tic).toSec();
+
+    ROS_INFO("dof %u, %d connections, %d queries (checksum %d)",dof,n_conns,n_queries,checksum);
+    ROS_INFO("  findConnection: Path %f us, PathIndex %f us",1e6*t_find_path/n_queries,1e6*t_find_index/n_queries);
+    ROS_INFO("  projection:     Path %f us, PathIndex %f us",1e6*t_proj_path/n_queries,1e6*t_proj_index/n_queries);
+  }
+
+  return 0;
+}
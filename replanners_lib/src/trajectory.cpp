@@ -14,6 +14,9 @@ Trajectory::Trajectory(const PathPtr path,
   planning_scene_ = planning_scene;
   group_name_ = group_name;
   moveit_utils_ = std::make_shared<MoveitUtils>(planning_scene,group_name);
+  table_spline_order_ = -1;
+  table_tolerance_ = TOLERANCE;
+  clearArcLengthTable();
 }
 
 Trajectory::Trajectory(const ros::NodeHandle &nh,
@@ -27,6 +30,9 @@ Trajectory::Trajectory(const ros::NodeHandle &nh,
   planning_scene_ = planning_scene;
   group_name_ = group_name;
   moveit_utils_ = std::make_shared<MoveitUtils>(planning_scene,group_name);
+  table_spline_order_ = -1;
+  table_tolerance_ = TOLERANCE;
+  clearArcLengthTable();
 }
 
 PathPtr Trajectory::computePath(const Eigen::VectorXd& start_conf, const Eigen::VectorXd& goal_conf, const TreeSolverPtr& solver, const bool& optimizePath, const double &max_time)
@@ -163,7 +169,10 @@ robot_trajectory::RobotTrajectoryPtr Trajectory::fromPath2Trj(const trajectory_m
     throw std::invalid_argument("Path not assigned");
 
   std::vector<Eigen::VectorXd> waypoints=path_->getWaypoints();
-  std::vector<moveit::core::RobotState> wp_state_vector = moveit_utils_->fromWaypoints2State(waypoints);
+  moveit_utils_->fromWaypoints2State(waypoints,wp_state_vector_);
+  std::vector<moveit::core::RobotState>& wp_state_vector = wp_state_vector_;
+
+  clearArcLengthTable(); //a new trajectory invalidates the arc-length table, it will be rebuilt at the first query
 
   trj_ = std::make_shared<robot_trajectory::RobotTrajectory>(kinematic_model_,group_name_);
   for(unsigned int j=0; j<waypoints.size();j++)
@@ -218,75 +227,181 @@ robot_trajectory::RobotTrajectoryPtr Trajectory::fromPath2Trj(const trajectory_m
   return trj_;
 }
 
-double Trajectory::getTimeFromTrjPoint(const Eigen::VectorXd &trj_point, const int& n_interval, const int &spline_order)
+void Trajectory::computeArcLengthTable(const int& spline_order)
+{
+  clearArcLengthTable();
+
+  moveit_msgs::RobotTrajectory tmp_trj_msg;
+  trj_->getRobotTrajectoryMsg(tmp_trj_msg);
+
+  table_interpolator_.setTrajectory(tmp_trj_msg);
+  table_interpolator_.setSplineOrder(spline_order);
+  table_spline_order_ = spline_order;
+  table_tolerance_ = TOLERANCE;
+
+  //The waypoints are read from trj_ itself, so the table can not get out of sync with the path
+  unsigned int n_waypoints = trj_->getWayPointCount();
+  if(n_waypoints == 0)
+    return;
+
+  /* With spline_order>1 the trajectory is not the polyline of the waypoints, so the interpolated trajectory is sampled
+   * between them. Inside a sample interval the trajectory is close to the chord and moves forward along it */
+  int n_sub = (spline_order>1)? ARC_LENGTH_TABLE_SUBSAMPLES:1;
+  unsigned int n_samples = (n_waypoints-1)*n_sub+1;
+
+  Eigen::VectorXd wp;
+  trajectory_msgs::JointTrajectoryPoint pnt;
+  trj_->getWayPoint(0).copyJointGroupPositions(group_name_,wp);
+  table_points_.resize(wp.size(),n_samples);
+  table_times_.reserve(n_samples);
+
+  table_points_.col(0) = wp;
+  table_times_.push_back(trj_->getWayPointDurationFromStart(0));
+
+  unsigned int s = 1;
+  double t, t_prev, t_next;
+  for(unsigned int i=1;i<n_waypoints;i++)
+  {
+    t_prev = table_times_.back();
+    t_next = trj_->getWayPointDurationFromStart(i);
+
+    for(int j=1;j<n_sub;j++)
+    {
+      t = t_prev+(t_next-t_prev)*j/n_sub;
+      table_interpolator_.interpolate(ros::Duration(t),pnt);
+      for(unsigned int k=0;k<pnt.positions.size();k++) table_points_(k,s) = pnt.positions[k];
+
+      table_times_.push_back(t);
+      s++;
+    }
+
+    trj_->getWayPoint(i).copyJointGroupPositions(group_name_,wp);
+    table_points_.col(s) = wp;
+    table_times_.push_back(t_next);
+    s++;
+  }
+
+  table_segments_ = table_points_.rightCols(n_samples-1)-table_points_.leftCols(n_samples-1);
+  table_segments_sq_length_ = table_segments_.colwise().squaredNorm().transpose().array();
+
+  table_abscissa_.resize(n_samples);
+  table_abscissa_[0] = 0.0;
+  for(unsigned int i=1;i<n_samples;i++)
+    table_abscissa_[i] = table_abscissa_[i-1]+std::sqrt(table_segments_sq_length_(i-1));
+
+  //Sampling error, measured in the middle of each sample interval. Points of the trajectory are projected within it
+  if(n_sub>1)
+  {
+    Eigen::VectorXd diff(wp.size());
+    double ratio;
+    for(unsigned int i=0;i<n_samples-1;i++)
+    {
+      table_interpolator_.interpolate(ros::Duration(0.5*(table_times_[i]+table_times_[i+1])),pnt);
+      for(unsigned int k=0;k<pnt.positions.size();k++) diff[k] = pnt.positions[k]-table_points_(k,i);
+
+      ratio = (table_segments_sq_length_(i)>0.0)? std::max(0.0,std::min(1.0,diff.dot(table_segments_.col(i))/table_segments_sq_length_(i))):0.0;
+      table_tolerance_ = std::max(table_tolerance_,2.0*(diff-ratio*table_segments_.col(i)).norm());
+    }
+  }
+
+  table_trj_ = trj_;
+}
+
+bool Trajectory::updateArcLengthTable(const int& spline_order)
 {
-  double t = -1.0;
   if(trj_ == nullptr)
   {
     ROS_ERROR("Trj not computed");
     throw std::invalid_argument("trj not computed");
   }
-  else
-  {
-    Eigen::VectorXd pos1,pos1_interval;
-    double err,dist,dist1,dist2,dist1_interval,t1_interval,t2_interval;
-    double end_time = trj_->getDuration();
-    double step = end_time/n_interval;
-    double min_err = std::numeric_limits<double>::infinity();
-    double t1 = 0;
-    double t2 = t1+step;
 
-    moveit_msgs::RobotTrajectory tmp_trj_msg;
-    trj_->getRobotTrajectoryMsg(tmp_trj_msg);
+  if(table_trj_ != trj_ || table_spline_order_ != spline_order)
+    computeArcLengthTable(spline_order);
+
+  return (table_times_.size()>1);
+}
 
-    trajectory_processing::SplineInterpolator interpolator;
-    interpolator.setTrajectory(tmp_trj_msg);
-    interpolator.setSplineOrder(spline_order);
+double Trajectory::projectOnArcLengthTable(const Eigen::VectorXd& point)
+{
+  /* Abscissa of the projection of point on the closest segment of the table. The queried points move forward along the
+   * trajectory, so the segments around the previous one are tried first */
+  int n_segments = table_segments_.cols();
 
-    pos1 = path_->getWaypoints().at(0);
-    dist1 = (trj_point-pos1).norm();
+  int idx = -1;
+  double t, dist2, ratio = 0.0, best_dist2 = std::numeric_limits<double>::infinity();
+  auto project = [&](const int& i)
+  {
+    Eigen::VectorXd diff = point-table_points_.col(i);
+    t = (table_segments_sq_length_(i)>0.0)? std::max(0.0,std::min(1.0,diff.dot(table_segments_.col(i))/table_segments_sq_length_(i))):0.0;
+    dist2 = (diff-t*table_segments_.col(i)).squaredNorm();
 
-    for(unsigned int i=0;i<2;i++)
+    if(dist2<best_dist2)
     {
-      while(t2<=end_time)
-      {
-        trajectory_msgs::JointTrajectoryPoint pnt2;
-        interpolator.interpolate(ros::Duration(t2),pnt2);
-        Eigen::VectorXd pos2(pnt2.positions.size());
-        for(unsigned int j=0; j<pnt2.positions.size();j++) pos2[j] = pnt2.positions.at(j);
+      best_dist2 = dist2;
+      ratio = t;
+      idx = i;
+    }
+  };
 
-        dist2 = (pos2-trj_point).norm();
-        dist = (pos2-pos1).norm();
-        err = std::abs(dist-dist1-dist2);
+  for(int i=std::max(0,table_hint_-1);i<std::min(table_hint_+3,n_segments);i++)
+    project(i);
 
-        if(err<min_err)
-        {
-          min_err = err;
-          t1_interval = t1;
-          t2_interval = t2;
-          dist1_interval = dist1;
-          pos1_interval = pos1;
+  if(best_dist2>table_tolerance_*table_tolerance_)
+  {
+    for(int i=0;i<n_segments;i++)
+      project(i);
+  }
 
-          t = t1+step*(dist1)/(dist1+dist2);
+  table_hint_ = idx;
+  return table_abscissa_[idx]+ratio*std::sqrt(table_segments_sq_length_(idx));
+}
 
-          if(err<1e-06) return t;
-        }
+double Trajectory::getTimeFromTrjPoint(const Eigen::VectorXd &trj_point, const int& n_interval, const int &spline_order)
+{
+  if(not updateArcLengthTable(spline_order))
+    return (table_times_.empty()? -1.0:table_times_.front());
 
-        t1 = t2;
-        t2 = t1+step;
-        dist1 = dist2;
-        pos1 = pos2;
-      }
+  return getTimeFromAbscissa(projectOnArcLengthTable(trj_point),n_interval,spline_order);
+}
 
-      step = (t2_interval-t1_interval)/100;
-      t1 = t1_interval;
-      t2 = t1+step;
-      end_time = t2_interval;
-      dist1 = dist1_interval;
-      pos1 = pos1_interval;
-    }
+double Trajectory::getTimeFromAbscissa(const double &abscissa, const int& n_interval, const int &spline_order)
+{
+  if(not updateArcLengthTable(spline_order))
+    return (table_times_.empty()? -1.0:table_times_.front());
+
+  if(abscissa<=0.0)
+    return table_times_.front();
+  if(abscissa>=table_abscissa_.back())
+    return table_times_.back();
+
+  //Samples bracketing the abscissa
+  unsigned int idx = std::upper_bound(table_abscissa_.begin(),table_abscissa_.end(),abscissa)-table_abscissa_.begin();
+
+  Eigen::VectorXd pos1 = table_points_.col(idx-1);
+  Eigen::VectorXd segment = table_segments_.col(idx-1);
+  double segment_norm = std::sqrt(table_segments_sq_length_(idx-1));
+  double target = abscissa-table_abscissa_[idx-1];
+
+  //Local refinement: bisection on the abscissa of the interpolated trajectory point, projected on the sample interval
+  trajectory_msgs::JointTrajectoryPoint pnt;
+  Eigen::VectorXd pos(pos1.size());
+
+  double t;
+  double t_low  = table_times_[idx-1];
+  double t_high = table_times_[idx  ];
+  for(int i=0;i<n_interval;i++)
+  {
+    t = 0.5*(t_low+t_high);
+
+    table_interpolator_.interpolate(ros::Duration(t),pnt);
+    for(unsigned int j=0;j<pnt.positions.size();j++) pos[j] = pnt.positions[j];
+
+    if((pos-pos1).dot(segment)/segment_norm<target)
+      t_low  = t;
+    else
+      t_high = t;
   }
 
-  return t;
+  return 0.5*(t_low+t_high);
 }
 }
@@ -0,0 +1,102 @@
+#include "replanners_lib/worker_pool.h"
+
+namespace pathplan
+{
+
+WorkerPool::WorkerPool(const unsigned int& n_threads)
+{
+  n_tasks_ = 0;
+  next_task_ = 0;
+  pending_ = 0;
+  stop_ = false;
+
+  threads_.reserve(n_threads);
+  for(unsigned int i=0;i<n_threads;i++)
+    threads_.push_back(std::thread(&WorkerPool::worker,this));
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+
+  for(std::thread& t:threads_)
+  {
+    if(t.joinable())
+      t.join();
+  }
+}
+
+void WorkerPool::runTasks(std::unique_lock<std::mutex>& lock)
+{
+  /* Called with lock held, takes the tasks one at a time and runs them without the lock */
+  while(next_task_<n_tasks_)
+  {
+    unsigned int idx = next_task_++;
+    lock.unlock();
+
+    std::exception_ptr exception = nullptr;
+    try
+    {
+      task_(idx);
+    }
+    catch(...)
+    {
+      exception = std::current_exception();
+    }
+
+    lock.lock();
+    if(exception && not exception_)
+      exception_ = exception;
+
+    if(--pending_ == 0)
+      done_cv_.notify_all();
+  }
+}
+
+void WorkerPool::worker()
+{
+  std::unique_lock<std::mutex> lock(mtx_);
+  while(true)
+  {
+    work_cv_.wait(lock,[this](){return stop_ || next_task_<n_tasks_;});
+    if(stop_)
+      return;
+
+    runTasks(lock);
+  }
+}
+
+void WorkerPool::parallelFor(const unsigned int& n_tasks, const std::function<void(const unsigned int&)>& task)
+{
+  if(n_tasks == 0)
+    return;
+
+  std::lock_guard<std::mutex> call_lock(call_mtx_);
+
+  std::unique_lock<std::mutex> lock(mtx_);
+  task_ = task;
+  n_tasks_ = n_tasks;
+  next_task_ = 0;
+  pending_ = n_tasks;
+  exception_ = nullptr;
+  work_cv_.notify_all();
+
+  runTasks(lock);
+  done_cv_.wait(lock,[this](){return pending_ == 0;});
+
+  n_tasks_ = next_task_ = 0;
+  task_ = nullptr;
+
+  std::exception_ptr exception = exception_;
+  exception_ = nullptr;
+  lock.unlock();
+
+  if(exception)
+    std::rethrow_exception(exception);
+}
+
+}